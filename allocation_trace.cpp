@@ -0,0 +1,188 @@
+#include "allocation_trace.h"
+#include "os_memory.h"
+
+#include <algorithm> // for std::min
+#include <cstring>   // for std::memmove
+#include <iostream>
+#include <new>       // for placement new
+#include <thread>    // for std::this_thread::yield
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const uint64_t TRACE_MAGIC = 0x3145434152544C41ull; // "ALTRACE1"
+
+// The start of a trace file. The events follow.
+struct TraceFileHeader {
+    uint64_t magic;
+    uint32_t event_size;
+    uint32_t reserved;
+};
+
+std::atomic<uint32_t> g_next_thread_id{1};
+
+// Initial-exec, so that reading it never allocates, even inside a preloaded
+// malloc replacement.
+__attribute__((tls_model("initial-exec"))) thread_local uint32_t t_thread_id = 0;
+
+uint16_t currentThreadId() {
+    if (t_thread_id == 0) {
+        t_thread_id = g_next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    }
+    return (uint16_t)t_thread_id;
+}
+
+// writeAll: write() until every byte is out or an error occurs.
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        const ssize_t written = write(fd, bytes, size);
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return true;
+}
+
+} // namespace
+
+// --- AllocationTrace Method Implementations ---
+
+AllocationTrace::AllocationTrace(const char* path, size_t capacity)
+    : m_fd(-1), m_capacity(1), m_mapping_size(0), m_events(nullptr), m_sequence(nullptr), m_head(0), m_tail(0),
+      m_start(std::chrono::steady_clock::now()) {
+    while (m_capacity < capacity) {
+        m_capacity *= 2;
+    }
+
+    // The ring lives in its own mapping rather than on the heap, which may be
+    // the very thing being traced.
+    m_mapping_size = os_round_to_pages(m_capacity * (sizeof(TraceEvent) + sizeof(std::atomic<uint64_t>)));
+    void* mapping = os_reserve(m_mapping_size);
+    if (!mapping || !os_commit(mapping, m_mapping_size)) {
+        std::cerr << "Could not reserve the trace buffer." << std::endl;
+        if (mapping) {
+            os_release(mapping, m_mapping_size);
+        }
+        return;
+    }
+    m_events = (TraceEvent*)mapping;
+    m_sequence = (std::atomic<uint64_t>*)(m_events + m_capacity);
+    for (size_t i = 0; i < m_capacity; ++i) {
+        new (&m_sequence[i]) std::atomic<uint64_t>(i);
+    }
+
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    const TraceFileHeader header = {TRACE_MAGIC, sizeof(TraceEvent), 0};
+    if (fd < 0 || !writeAll(fd, &header, sizeof(header))) {
+        std::cerr << "Could not create the trace file." << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    m_fd = fd;
+}
+
+AllocationTrace::~AllocationTrace() {
+    if (m_fd >= 0) {
+        flush();
+        close(m_fd);
+    }
+    if (m_events) {
+        os_release(m_events, m_mapping_size);
+    }
+}
+
+void AllocationTrace::record(TraceEvent::Op op, const void* address, const void* previous, size_t size,
+                             size_t alignment) {
+    if (m_fd < 0) {
+        return;
+    }
+
+    const uint64_t sequence = m_head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& event = m_events[sequence & (m_capacity - 1)];
+    std::atomic<uint64_t>& slot = m_sequence[sequence & (m_capacity - 1)];
+
+    // The slot still holds an event from the previous lap: the ring is full.
+    while (slot.load(std::memory_order_acquire) != sequence) {
+        if (drain() == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    unsigned alignment_log2 = 0;
+    while (alignment > 1 && (size_t(1) << alignment_log2) < alignment) {
+        ++alignment_log2;
+    }
+    event.timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - m_start).count();
+    event.address = (uintptr_t)address;
+    event.previous = (uintptr_t)previous;
+    event.size = (uint32_t)std::min<size_t>(size, UINT32_MAX);
+    event.thread = currentThreadId();
+    event.op = op;
+    event.alignment_log2 = (uint8_t)alignment_log2;
+    slot.store(sequence + 1, std::memory_order_release);
+}
+
+void AllocationTrace::flush() {
+    if (m_fd >= 0) {
+        while (drain() > 0) {
+        }
+    }
+}
+
+size_t AllocationTrace::drain() {
+    std::lock_guard<std::mutex> guard(m_flush_lock);
+
+    // Take the run of published events from m_tail, stopping at the first one
+    // that is still being written or at the end of the ring, so the run is one
+    // contiguous write.
+    const size_t first = m_tail & (m_capacity - 1);
+    size_t count = 0;
+    while (first + count < m_capacity &&
+           m_sequence[first + count].load(std::memory_order_acquire) == m_tail + count + 1) {
+        ++count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // A failed write drops the events rather than stalling every allocation.
+    writeAll(m_fd, m_events + first, count * sizeof(TraceEvent));
+    for (size_t i = 0; i < count; ++i) {
+        m_sequence[first + i].store(m_tail + i + m_capacity, std::memory_order_release);
+    }
+    m_tail += count;
+    return count;
+}
+
+bool AllocationTrace::read(const char* path, std::vector<TraceEvent>& events) {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    TraceFileHeader header;
+    bool valid = ::read(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) && header.magic == TRACE_MAGIC &&
+                 header.event_size == sizeof(TraceEvent);
+
+    // A trace cut short by a crash ends in a partial event, which is dropped.
+    TraceEvent buffer[1024];
+    char* end = (char*)buffer;
+    ssize_t got = 0;
+    while (valid && (got = ::read(fd, end, sizeof(buffer) - (end - (char*)buffer))) > 0) {
+        end += got;
+        const size_t complete = (size_t)(end - (char*)buffer) / sizeof(TraceEvent);
+        events.insert(events.end(), buffer, buffer + complete);
+        const size_t leftover = (size_t)(end - (char*)(buffer + complete));
+        std::memmove(buffer, buffer + complete, leftover);
+        end = (char*)buffer + leftover;
+    }
+    close(fd);
+    return valid && got == 0;
+}
@@ -0,0 +1,98 @@
+#ifndef ALLOCATION_TRACE_H
+#define ALLOCATION_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <mutex>
+#include <vector>
+
+// =================================================================================
+// TraceEvent: One recorded call, as it is laid out both in memory and in a
+// trace file.
+//
+// A block is identified by its payload address, which is unique among the
+// blocks allocated at any one time; a replay matches each Free and Reallocate
+// to the most recent event that produced the same address.
+// =================================================================================
+struct TraceEvent {
+    enum Op : uint8_t {
+        Allocate = 1,
+        Free = 2,
+        Reallocate = 3
+    };
+
+    uint64_t timestamp;      // Nanoseconds since the trace was opened.
+    uint64_t address;        // The block's payload address.
+    uint64_t previous;       // Reallocate: the block's address before the call; otherwise 0.
+    uint32_t size;           // Bytes requested, capped at UINT32_MAX; 0 for Free.
+    uint16_t thread;         // A small number that identifies the calling thread.
+    uint8_t op;
+    uint8_t alignment_log2;  // Allocate: log2 of the alignment asked for, or 0 for the default.
+};
+static_assert(sizeof(TraceEvent) == 32, "trace events are written to files as they are");
+
+// =================================================================================
+// AllocationTrace Class
+//
+// Records allocation calls to a file, for replaying later against other
+// engines and policies (see bench/trace_replay). Attach it to one or more
+// allocators with Allocator::set_trace.
+//
+// Events go into a fixed ring of 'capacity' slots. A recording thread claims a
+// slot with one atomic add and publishes it with one store, so threads never
+// wait on each other while the ring has room. Published events are written to
+// the file in order by flush(), or by whichever thread finds the ring full,
+// which then waits for its slot. Nothing here allocates from the heap, so a
+// trace can record the process's own malloc.
+// =================================================================================
+class AllocationTrace {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 65536;
+
+    // Constructor: Creates (or truncates) the trace file at 'path'. The
+    // capacity is rounded up to a power of two.
+    explicit AllocationTrace(const char* path, size_t capacity = DEFAULT_CAPACITY);
+
+    // Destructor: Writes out the remaining events and closes the file.
+    ~AllocationTrace();
+
+    AllocationTrace(const AllocationTrace&) = delete;
+    AllocationTrace& operator=(const AllocationTrace&) = delete;
+
+    // is_open: False if the file or the ring could not be created.
+    bool is_open() const { return m_fd >= 0; }
+
+    // record: Add an event. Safe to call from any thread.
+    void record(TraceEvent::Op op, const void* address, const void* previous, size_t size, size_t alignment = 0);
+
+    // flush: Write every event published so far to the file.
+    void flush();
+
+    // event_count: Events recorded so far, written out or not.
+    uint64_t event_count() const { return m_head.load(std::memory_order_relaxed); }
+
+    // read: Load the events of a trace file. Returns false if it is not one.
+    static bool read(const char* path, std::vector<TraceEvent>& events);
+
+private:
+    int m_fd;
+    size_t m_capacity;
+    size_t m_mapping_size;
+    TraceEvent* m_events;
+
+    // Slot i may be written by the event with sequence number n, where
+    // n % capacity == i, once m_sequence[i] == n. Publishing it sets n + 1, and
+    // writing it to the file sets n + capacity, handing it to the next lap.
+    std::atomic<uint64_t>* m_sequence;
+    std::atomic<uint64_t> m_head;  // Sequence number of the next event to claim.
+    uint64_t m_tail;               // Sequence number of the next event to write out.
+    std::mutex m_flush_lock;       // Guards m_tail and the file.
+    std::chrono::steady_clock::time_point m_start;
+
+    // drain: Write out the published events from m_tail on. Returns how many.
+    size_t drain();
+};
+
+#endif // ALLOCATION_TRACE_H
@@ -0,0 +1,1014 @@
+#include "allocator.h"
+#include "allocation_trace.h"
+#include "os_memory.h"
+
+#include <iomanip> // for std::setw
+#include <algorithm> // for std::max
+#include <cstring> // for std::memcpy
+
+// --- Allocator Method Implementations ---
+
+Allocator::Allocator(FitPolicy policy)
+    : m_memory_pool(nullptr), m_reserved_size(0), m_committed_size(0), m_heap_start(nullptr),
+      m_pool_size(0), m_owns_pool(false), m_policy(policy), m_fl_bitmap(0), m_free_bytes(0), m_free_block_count(0),
+      m_peak_allocated_bytes(0), m_allocation_count(0), m_free_count(0), m_largest_free_block(0),
+      m_free_bound(0), m_largest_free_stale(false), m_purge_mode(PurgeMode::DontNeed),
+      m_purge_decay(0), m_frees_until_decay_check(PURGE_CHECK_INTERVAL), m_trace(nullptr) {
+    clearFreeLists();
+}
+
+Allocator::Allocator(size_t pool_size, FitPolicy policy, size_t max_pool_size) : Allocator(policy) {
+    // The padding in front of the first block and the epilogue after the last
+    // one take up one granule between them.
+    if (pool_size < BLOCK_GRANULE + MIN_BLOCK_SIZE) {
+        std::cerr << "Pool size is too small." << std::endl;
+        return;
+    }
+
+#ifdef ALLOCATOR_COMPACT_LINKS
+    // Sizes and links are 32-bit offsets into the pool.
+    if (std::max(pool_size, max_pool_size) > UINT32_MAX - os_page_size()) {
+        std::cerr << "Pool size is too large." << std::endl;
+        return;
+    }
+#endif
+
+    // Reserve the address space for the largest the pool may grow to, but only
+    // commit what is needed now.
+    m_reserved_size = os_round_to_pages(std::max(pool_size, max_pool_size));
+    m_committed_size = os_round_to_pages(pool_size);
+    m_memory_pool = os_reserve(m_reserved_size);
+    if (!m_memory_pool || !os_commit(m_memory_pool, m_committed_size)) {
+        std::cerr << "Could not reserve the memory pool." << std::endl;
+        if (m_memory_pool) {
+            os_release(m_memory_pool, m_reserved_size);
+            m_memory_pool = nullptr;
+        }
+        return;
+    }
+    m_owns_pool = true;
+    initHeap(pool_size);
+}
+
+Allocator::Allocator(void* memory, size_t size, FitPolicy policy) : Allocator(policy) {
+    if (size < BLOCK_GRANULE + MIN_BLOCK_SIZE) {
+        std::cerr << "Pool size is too small." << std::endl;
+        return;
+    }
+    if ((uintptr_t)memory % BLOCK_GRANULE != 0) {
+        std::cerr << "Pool memory must be aligned to " << BLOCK_GRANULE << " bytes." << std::endl;
+        return;
+    }
+#ifdef ALLOCATOR_COMPACT_LINKS
+    if (size > UINT32_MAX - os_page_size()) {
+        std::cerr << "Pool size is too large." << std::endl;
+        return;
+    }
+#endif
+
+    // All of the memory is usable and none of it can be added to, so the pool
+    // never grows.
+    m_memory_pool = memory;
+    m_reserved_size = m_committed_size = size;
+    initHeap(size);
+}
+
+Allocator::~Allocator() {
+    if (m_memory_pool && m_owns_pool) {
+        os_release(m_memory_pool, m_reserved_size);
+    }
+}
+
+void Allocator::initHeap(size_t pool_size) {
+    // The pool memory is granule aligned, so skipping BLOCK_GRANULE - sizeof(BlockHeader)
+    // bytes puts the first payload on a granule boundary.
+    m_heap_start = (char*)m_memory_pool + BLOCK_GRANULE - sizeof(BlockHeader);
+    m_pool_size = (pool_size - BLOCK_GRANULE) & ~(BLOCK_GRANULE - 1);
+    ((BlockHeader*)(m_heap_start + m_pool_size))->size_and_flags = 0;
+
+    // The entire pool starts as a single, large free block.
+    FreeBlock* initial_block = (FreeBlock*)m_heap_start;
+    initial_block->size_and_flags = (BlockWord)m_pool_size;
+    addToFreeList(initial_block);
+}
+
+void Allocator::clearFreeLists() {
+    for (size_t i = 0; i < NUM_FREE_LISTS; ++i) {
+        m_free_lists[i] = NULL_LINK;
+    }
+    for (size_t i = 0; i < TLSF_FL_COUNT; ++i) {
+        m_sl_bitmap[i] = 0;
+    }
+    m_fl_bitmap = 0;
+    m_free_bytes = 0;
+    m_free_block_count = 0;
+    m_largest_free_block = 0;
+    m_free_bound = 0;
+    m_largest_free_stale = false;
+}
+
+void Allocator::rebase(void* memory) {
+    m_heap_start = (char*)memory + (m_heap_start - (char*)m_memory_pool);
+    m_memory_pool = memory;
+}
+
+size_t Allocator::sizeClassOf(size_t size) {
+    return NUM_SIZE_CLASSES - 1 - __builtin_clzll(size);
+}
+
+void Allocator::tlsfMapping(size_t size, unsigned& fl, unsigned& sl) {
+    if (size < TLSF_SMALL_BLOCK) {
+        // Small blocks are spread linearly over the lists of first level 0.
+        fl = 0;
+        sl = (unsigned)(size / (TLSF_SMALL_BLOCK / TLSF_SL_COUNT));
+    } else {
+        const unsigned msb = (unsigned)sizeClassOf(size);
+        fl = msb - TLSF_FL_SHIFT + 1;
+        sl = (unsigned)(size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+    }
+}
+
+size_t Allocator::freeListIndex(size_t size) const {
+    switch (m_policy) {
+    case FitPolicy::SegregatedFit:
+        return sizeClassOf(size);
+    case FitPolicy::TLSF: {
+        unsigned fl, sl;
+        tlsfMapping(size, fl, sl);
+        return fl * TLSF_SL_COUNT + sl;
+    }
+    default:
+        return 0;
+    }
+}
+
+BlockHeader* Allocator::nextPhysicalBlock(BlockHeader* block) const {
+    return (BlockHeader*)((char*)block + block->size());
+}
+
+void Allocator::markFree(BlockHeader* block) {
+    // The block is new or has changed shape, so it is neither purged nor aged.
+    block->set_word((block->word() & ~(BlockHeader::PURGED | BlockHeader::AGED)) | BlockHeader::IS_FREE);
+    // Boundary tag: the block's size, stored in its last word.
+    *(BlockWord*)((char*)block + block->size() - sizeof(BlockWord)) = (BlockWord)block->size();
+    nextPhysicalBlock(block)->set_prev_free(true);
+}
+
+void Allocator::markAllocated(BlockHeader* block) {
+    block->set_free(false);
+    nextPhysicalBlock(block)->set_prev_free(false);
+}
+
+void Allocator::removeFromFreeList(FreeBlock* block) {
+    const size_t index = freeListIndex(block->size());
+    m_free_bytes -= block->size();
+    --m_free_block_count;
+    noteFreeRemoved(block->size());
+
+    if (m_policy == FitPolicy::BestFit) {
+        treeRemove(block);
+        return;
+    }
+
+    if (block->prev) {
+        linked(block->prev)->next = block->next;
+    } else {
+        // This block was the head of the list.
+        m_free_lists[index] = block->next;
+    }
+    if (block->next) {
+        linked(block->next)->prev = block->prev;
+    }
+
+    // Keep the bitmaps in step with the lists that just became empty.
+    if (m_free_lists[index] == NULL_LINK) {
+        if (m_policy == FitPolicy::SegregatedFit) {
+            m_fl_bitmap &= ~(uint64_t(1) << index);
+        } else if (m_policy == FitPolicy::TLSF) {
+            const size_t fl = index / TLSF_SL_COUNT;
+            m_sl_bitmap[fl] &= ~(1u << (index % TLSF_SL_COUNT));
+            if (m_sl_bitmap[fl] == 0) {
+                m_fl_bitmap &= ~(uint64_t(1) << fl);
+            }
+        }
+    }
+}
+
+void Allocator::addToFreeList(FreeBlock* block) {
+    const size_t index = freeListIndex(block->size());
+    m_free_bytes += block->size();
+    ++m_free_block_count;
+    noteFreeAdded(block->size());
+
+    markFree(block);
+    if (m_policy == FitPolicy::BestFit) {
+        treeInsert(block);
+        return;
+    }
+
+    FreeLink& head = m_free_lists[index];
+    block->next = head;
+    block->prev = NULL_LINK;
+    if (head) {
+        linked(head)->prev = linkTo(block);
+    }
+    head = linkTo(block);
+
+    if (m_policy == FitPolicy::SegregatedFit) {
+        m_fl_bitmap |= uint64_t(1) << index;
+    } else if (m_policy == FitPolicy::TLSF) {
+        const size_t fl = index / TLSF_SL_COUNT;
+        m_sl_bitmap[fl] |= 1u << (index % TLSF_SL_COUNT);
+        m_fl_bitmap |= uint64_t(1) << fl;
+    }
+}
+
+void Allocator::replaceInFreeList(FreeBlock* old_block, FreeBlock* new_block) {
+    m_free_bytes = m_free_bytes - old_block->size() + new_block->size();
+    noteFreeRemoved(old_block->size());
+    noteFreeAdded(new_block->size());
+
+    markFree(new_block);
+    new_block->next = old_block->next;
+    new_block->prev = old_block->prev;
+    if (old_block->prev) {
+        linked(old_block->prev)->next = linkTo(new_block);
+    } else {
+        m_free_lists[freeListIndex(old_block->size())] = linkTo(new_block);
+    }
+    if (old_block->next) {
+        linked(old_block->next)->prev = linkTo(new_block);
+    }
+}
+
+void Allocator::noteFreeAdded(size_t size) {
+    if (m_largest_free_stale) {
+        // Every other block is at most the bound, so a block at or above it
+        // is the largest.
+        if (size >= m_free_bound) {
+            m_largest_free_block = size;
+            m_largest_free_stale = false;
+        }
+    } else if (size > m_largest_free_block) {
+        m_free_bound = std::max(m_free_bound, m_largest_free_block);
+        m_largest_free_block = size;
+    } else {
+        m_free_bound = std::max(m_free_bound, size);
+    }
+}
+
+void Allocator::noteFreeRemoved(size_t size) {
+    // Any other block leaves the bound an upper bound. Losing the largest
+    // leaves it one for every block, which is what a stale value needs.
+    if (!m_largest_free_stale && size == m_largest_free_block) {
+        m_largest_free_stale = true;
+    }
+}
+
+bool Allocator::sharesFreeList(size_t size_a, size_t size_b) const {
+    return m_policy != FitPolicy::BestFit && freeListIndex(size_a) == freeListIndex(size_b);
+}
+
+bool Allocator::treeLess(const FreeBlock* a, const FreeBlock* b) {
+    const size_t a_size = a->size();
+    const size_t b_size = b->size();
+    return a_size < b_size || (a_size == b_size && a < b);
+}
+
+uint64_t Allocator::treePriority(const FreeBlock* block) const {
+    // Fibonacci hashing spreads the offsets, whose low bits are all alike,
+    // over the whole word.
+    return (uint64_t)(((const char*)block - (const char*)m_memory_pool) >> 3) * 0x9E3779B97F4A7C15ull;
+}
+
+void Allocator::treeInsert(FreeBlock* block) {
+    block->left = NULL_LINK;
+    block->right = NULL_LINK;
+
+    // Walk down to where the block belongs in the heap order...
+    const uint64_t priority = treePriority(block);
+    FreeLink* link = &m_free_lists[0];
+    while (*link && treePriority(linked(*link)) > priority) {
+        FreeBlock* node = linked(*link);
+        link = treeLess(block, node) ? &node->left : &node->right;
+    }
+
+    // ...then split the subtree found there into the blocks that sort before
+    // and after it, which become its children.
+    FreeBlock* subtree = linked(*link);
+    FreeLink* smaller = &block->left;
+    FreeLink* larger = &block->right;
+    while (subtree) {
+        if (treeLess(subtree, block)) {
+            *smaller = linkTo(subtree);
+            smaller = &subtree->right;
+            subtree = linked(subtree->right);
+        } else {
+            *larger = linkTo(subtree);
+            larger = &subtree->left;
+            subtree = linked(subtree->left);
+        }
+    }
+    *smaller = NULL_LINK;
+    *larger = NULL_LINK;
+    *link = linkTo(block);
+}
+
+void Allocator::treeRemove(FreeBlock* block) {
+    FreeLink* link = &m_free_lists[0];
+    while (linked(*link) != block) {
+        FreeBlock* node = linked(*link);
+        link = treeLess(block, node) ? &node->left : &node->right;
+    }
+
+    // Replace the block with the merge of its two subtrees, every block of the
+    // left one sorting before every block of the right.
+    FreeBlock* smaller = linked(block->left);
+    FreeBlock* larger = linked(block->right);
+    while (smaller && larger) {
+        if (treePriority(smaller) > treePriority(larger)) {
+            *link = linkTo(smaller);
+            link = &smaller->right;
+            smaller = linked(smaller->right);
+        } else {
+            *link = linkTo(larger);
+            link = &larger->left;
+            larger = linked(larger->left);
+        }
+    }
+    *link = linkTo(smaller ? smaller : larger);
+}
+
+template <typename Fn>
+void Allocator::forEachTreeBlock(FreeBlock* node, Fn&& fn) const {
+    // The treap is balanced in expectation, so the recursion stays shallow.
+    if (node) {
+        forEachTreeBlock(linked(node->left), fn);
+        FreeBlock* right = linked(node->right);
+        fn(node);
+        forEachTreeBlock(right, fn);
+    }
+}
+
+FreeBlock* Allocator::findFirstFit(size_t total_size) const {
+    // Traverse the free list to find a suitable block.
+    for (FreeBlock* current = linked(m_free_lists[0]); current; current = linked(current->next)) {
+        if (current->size() >= total_size) {
+            return current;
+        }
+    }
+    return nullptr;
+}
+
+FreeBlock* Allocator::findSegregatedFit(size_t total_size) const {
+    // Every block in a class above the request's own class is large enough, so
+    // the lowest non-empty one of those can be used without searching.
+    const size_t request_class = sizeClassOf(total_size);
+    if (request_class + 1 < NUM_SIZE_CLASSES) {
+        const uint64_t larger_classes = m_fl_bitmap & (~uint64_t(0) << (request_class + 1));
+        if (larger_classes) {
+            return linked(m_free_lists[__builtin_ctzll(larger_classes)]);
+        }
+    }
+
+    // Only the request's own class is left, and its blocks may be smaller than
+    // the request, so it has to be searched.
+    for (FreeBlock* current = linked(m_free_lists[request_class]); current; current = linked(current->next)) {
+        if (current->size() >= total_size) {
+            return current;
+        }
+    }
+    return nullptr;
+}
+
+FreeBlock* Allocator::findTlsfFit(size_t total_size) const {
+    // Past the start of the last list the rounding below would wrap around to
+    // a small size (blockSizeFor saturates huge requests at SIZE_MAX), and no
+    // block can be that large anyway.
+    const size_t largest_mappable = size_t(2 * TLSF_SL_COUNT - 1) << (63 - TLSF_SL_LOG2);
+    if (total_size > largest_mappable) {
+        return nullptr;
+    }
+
+    // Round the request up to the next list boundary, so that every block on the
+    // list it maps to (and on any later list) is large enough.
+    size_t rounded = total_size;
+    if (total_size >= TLSF_SMALL_BLOCK) {
+        rounded += (size_t(1) << (sizeClassOf(total_size) - TLSF_SL_LOG2)) - 1;
+    } else {
+        rounded += TLSF_SMALL_BLOCK / TLSF_SL_COUNT - 1;
+    }
+
+    unsigned fl, sl;
+    tlsfMapping(rounded, fl, sl);
+    if (fl >= TLSF_FL_COUNT) {
+        return nullptr;
+    }
+
+    // First look for a non-empty list at or after sl in the same first level,
+    // then for the first non-empty list of any larger first level.
+    uint32_t sl_map = m_sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        const uint64_t fl_map = (fl + 1 < 64) ? m_fl_bitmap & (~uint64_t(0) << (fl + 1)) : 0;
+        if (!fl_map) {
+            return nullptr;
+        }
+        fl = __builtin_ctzll(fl_map);
+        sl_map = m_sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return linked(m_free_lists[fl * TLSF_SL_COUNT + sl]);
+}
+
+FreeBlock* Allocator::findBestFit(size_t total_size) const {
+    // The leftmost block that is large enough: the smallest fit, and among
+    // blocks of that size the lowest-addressed one.
+    FreeBlock* best = nullptr;
+    for (FreeBlock* node = linked(m_free_lists[0]); node;) {
+        if (node->size() >= total_size) {
+            best = node;
+            node = linked(node->left);
+        } else {
+            node = linked(node->right);
+        }
+    }
+    return best;
+}
+
+FreeBlock* Allocator::findFreeBlock(size_t total_size) const {
+    switch (m_policy) {
+    case FitPolicy::SegregatedFit:
+        return findSegregatedFit(total_size);
+    case FitPolicy::TLSF:
+        return findTlsfFit(total_size);
+    case FitPolicy::BestFit:
+        return findBestFit(total_size);
+    default:
+        return findFirstFit(total_size);
+    }
+}
+
+size_t Allocator::blockSizeFor(size_t size) {
+    // Requests this large can never be satisfied; don't let the rounding wrap.
+    if (size > SIZE_MAX / 2) {
+        return SIZE_MAX;
+    }
+    // The total size needed includes the header, in whole granules. Every block
+    // must be able to hold its free-list pointers and boundary tag once it is
+    // freed again.
+    return std::max((size + sizeof(BlockHeader) + BLOCK_GRANULE - 1) & ~(BLOCK_GRANULE - 1), MIN_BLOCK_SIZE);
+}
+
+void* Allocator::allocateFromBlock(FreeBlock* current, size_t total_size_needed) {
+    // --- Block Splitting ---
+    // If the block is large enough to be split, do so.
+    // The remaining part must be large enough to hold a header and boundary tag.
+    // Both parts stay whole granules, so the remainder's payload is aligned too.
+    if (current->size() >= total_size_needed + MIN_BLOCK_SIZE) {
+
+        // Create the new free block from the remainder. Its left neighbour is
+        // being allocated, so none of its flags are set yet.
+        FreeBlock* new_free_block = (FreeBlock*)((char*)current + total_size_needed);
+        new_free_block->size_and_flags = (BlockWord)(current->size() - total_size_needed);
+
+        // If the remainder belongs on the same list, it simply takes the old
+        // block's place; otherwise it moves to the list for its own size class.
+        if (sharesFreeList(current->size(), new_free_block->size())) {
+            replaceInFreeList(current, new_free_block);
+        } else {
+            removeFromFreeList(current);
+            addToFreeList(new_free_block);
+        }
+
+        // Update the original block to be the allocated size.
+        current->set_size(total_size_needed);
+
+    } else {
+        // The block is a perfect fit or too small to split. Use the whole thing.
+        removeFromFreeList(current);
+        markAllocated(current);
+    }
+
+    current->set_word(current->word() & ~(BlockHeader::IS_FREE | BlockHeader::PURGED | BlockHeader::AGED));
+    // Return a pointer to the memory region *after* the header.
+    return (void*)((char*)current + sizeof(BlockHeader));
+}
+
+void* Allocator::allocate(size_t size) {
+    void* ptr = allocateUntraced(size);
+    if (m_trace && ptr) {
+        m_trace->record(TraceEvent::Allocate, ptr, nullptr, size);
+    }
+    return ptr;
+}
+
+void* Allocator::try_allocate(size_t size) {
+    void* ptr = allocateUntraced(size, false);
+    if (m_trace && ptr) {
+        m_trace->record(TraceEvent::Allocate, ptr, nullptr, size);
+    }
+    return ptr;
+}
+
+void* Allocator::allocateUntraced(size_t size, bool report_failure) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    const size_t total_size_needed = blockSizeFor(size);
+    FreeBlock* current = findFreeBlock(total_size_needed);
+    while (!current && growPool(total_size_needed)) {
+        current = findFreeBlock(total_size_needed);
+    }
+    if (!current) {
+        // No suitable block found.
+        if (report_failure) {
+            std::cerr << "Out of memory!" << std::endl;
+        }
+        return nullptr;
+    }
+
+    void* ptr = allocateFromBlock(current, total_size_needed);
+    noteAllocation();
+    return ptr;
+}
+
+void* Allocator::aligned_allocate(size_t size, size_t alignment) {
+    return alignedAllocate(size, alignment, true);
+}
+
+void* Allocator::try_aligned_allocate(size_t size, size_t alignment) {
+    return alignedAllocate(size, alignment, false);
+}
+
+void* Allocator::alignedAllocate(size_t size, size_t alignment, bool report_failure) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        std::cerr << "Alignment must be a power of two." << std::endl;
+        return nullptr;
+    }
+    if (alignment <= BLOCK_GRANULE) {
+        // Every payload is already this well aligned.
+        void* ptr = allocateUntraced(size, report_failure);
+        if (m_trace && ptr) {
+            m_trace->record(TraceEvent::Allocate, ptr, nullptr, size, alignment);
+        }
+        return ptr;
+    }
+    if (size == 0 || size > SIZE_MAX / 2 - alignment) {
+        return nullptr;
+    }
+
+    // Look for a block with room for the request plus the worst-case padding in
+    // front of it. The padding is either zero or at least MIN_BLOCK_SIZE, so that
+    // it can be returned to the free list as a block of its own.
+    const size_t total_size_needed = blockSizeFor(size);
+    const size_t search_size = total_size_needed + alignment + MIN_BLOCK_SIZE;
+    FreeBlock* current = findFreeBlock(search_size);
+    while (!current && growPool(search_size)) {
+        current = findFreeBlock(search_size);
+    }
+    if (!current) {
+        if (report_failure) {
+            std::cerr << "Out of memory!" << std::endl;
+        }
+        return nullptr;
+    }
+
+    const uintptr_t payload = (uintptr_t)current + sizeof(BlockHeader);
+    uintptr_t aligned_payload = (payload + alignment - 1) & ~(alignment - 1);
+    if (aligned_payload != payload && aligned_payload - payload < MIN_BLOCK_SIZE) {
+        aligned_payload += alignment;
+    }
+
+    const size_t padding = aligned_payload - payload;
+    if (padding != 0) {
+        // Cut the padding off the front as a free block of its own. Its size
+        // changes, so it may move to a different free list.
+        FreeBlock* aligned_block = (FreeBlock*)(aligned_payload - sizeof(BlockHeader));
+        aligned_block->size_and_flags = (BlockWord)(current->size() - padding);
+        removeFromFreeList(current);
+        current->set_size(padding);
+        addToFreeList(current);
+        addToFreeList(aligned_block);
+        current = aligned_block;
+    }
+
+    void* ptr = allocateFromBlock(current, total_size_needed);
+    noteAllocation();
+    if (m_trace) {
+        m_trace->record(TraceEvent::Allocate, ptr, nullptr, size, alignment);
+    }
+    return ptr;
+}
+
+void Allocator::deallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (m_trace) {
+        m_trace->record(TraceEvent::Free, ptr, nullptr, 0);
+    }
+    deallocateUntraced(ptr);
+}
+
+void Allocator::deallocateUntraced(void* ptr) {
+    // Get the header from the user's pointer.
+    releaseBlock((FreeBlock*)((char*)ptr - sizeof(BlockHeader)));
+    ++m_free_count;
+
+    // --- Decay-Based Purging ---
+    if (m_purge_decay.count() > 0 && --m_frees_until_decay_check == 0) {
+        m_frees_until_decay_check = PURGE_CHECK_INTERVAL;
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - m_last_decay_tick >= m_purge_decay) {
+            m_last_decay_tick = now;
+            purgeFreeBlocks(true);
+        }
+    }
+}
+
+void Allocator::deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    // A block is at least the size its request needed, and less than a minimum
+    // block bigger, since anything more would have been split off.
+    const BlockHeader* block = (const BlockHeader*)((const char*)ptr - sizeof(BlockHeader));
+    const size_t total_size = blockSizeFor(size);
+    if (block->size() < total_size || block->size() - total_size >= MIN_BLOCK_SIZE) {
+        std::cerr << "Deallocation size does not match the block." << std::endl;
+        return;
+    }
+    deallocate(ptr);
+}
+
+void* Allocator::reallocate(void* ptr, size_t new_size) {
+    return reallocateWith(ptr, new_size, true);
+}
+
+void* Allocator::try_reallocate(void* ptr, size_t new_size) {
+    return reallocateWith(ptr, new_size, false);
+}
+
+void* Allocator::reallocateWith(void* ptr, size_t new_size, bool report_failure) {
+    if (ptr == nullptr) {
+        return report_failure ? allocate(new_size) : try_allocate(new_size);
+    }
+    if (new_size == 0) {
+        deallocate(ptr);
+        return nullptr;
+    }
+
+    void* new_ptr = resizeBlock(ptr, new_size, report_failure);
+    if (m_trace && new_ptr) {
+        m_trace->record(TraceEvent::Reallocate, new_ptr, ptr, new_size);
+    }
+    return new_ptr;
+}
+
+void* Allocator::resizeBlock(void* ptr, size_t new_size, bool report_failure) {
+    BlockHeader* block = (BlockHeader*)((char*)ptr - sizeof(BlockHeader));
+    const size_t total_size_needed = blockSizeFor(new_size);
+
+    // --- Grow In Place ---
+    // Absorb the free block to the right, if there is one and it is enough.
+    FreeBlock* target = nullptr;
+    if (block->size() < total_size_needed) {
+        BlockHeader* next = nextPhysicalBlock(block);
+        const bool next_is_enough = next->is_free() && block->size() + next->size() >= total_size_needed;
+        if (!next_is_enough) {
+            // Moving into free space elsewhere in the pool beats growing it.
+            // Only when there is none, and this block (or the free block after
+            // it) ends the pool, is the pool extended, and then by just the
+            // shortfall rather than by the doubling allocate uses.
+            const BlockHeader* epilogue = (BlockHeader*)(m_heap_start + m_pool_size);
+            const BlockHeader* last = next->is_free() ? nextPhysicalBlock(next) : next;
+            target = findFreeBlock(total_size_needed);
+            if (!target && last == epilogue) {
+                growPool(total_size_needed - block->size(), true);
+            }
+        }
+
+        if (!target && next->is_free() && block->size() + next->size() >= total_size_needed) {
+            removeFromFreeList((FreeBlock*)next);
+            block->set_size(block->size() + next->size());
+            markAllocated(block);
+        }
+    }
+
+    // --- Shrink In Place ---
+    // A block that just grew may have absorbed far more than it needs, so the
+    // peak is only taken once the excess is split off again.
+    if (block->size() >= total_size_needed) {
+        trimBlock(block, total_size_needed);
+        m_peak_allocated_bytes = std::max(m_peak_allocated_bytes, m_pool_size - m_free_bytes);
+        return ptr;
+    }
+
+    // --- Move ---
+    void* new_ptr = nullptr;
+    if (target) {
+        new_ptr = allocateFromBlock(target, total_size_needed);
+        noteAllocation();
+    } else {
+        new_ptr = allocateUntraced(new_size, report_failure);
+    }
+    if (!new_ptr) {
+        return nullptr;
+    }
+    std::memcpy(new_ptr, ptr, usable_size(ptr));
+    deallocateUntraced(ptr);
+    return new_ptr;
+}
+
+void Allocator::trimBlock(BlockHeader* block, size_t total_size) {
+    if (block->size() < total_size + MIN_BLOCK_SIZE) {
+        return;
+    }
+
+    // The tail's left neighbour stays allocated, so none of its flags are set;
+    // releasing it coalesces it with a free block to its right.
+    FreeBlock* tail = (FreeBlock*)((char*)block + total_size);
+    tail->size_and_flags = (BlockWord)(block->size() - total_size);
+    block->set_size(total_size);
+    releaseBlock(tail);
+}
+
+void Allocator::releaseBlock(FreeBlock* block_to_free) {
+    // --- Coalescing (Merging) Logic ---
+    
+    // 1. Coalesce with the block physically to the right.
+    FreeBlock* next_physical_block = (FreeBlock*)nextPhysicalBlock(block_to_free);
+    
+    // Check if the next block is free. The epilogue never is, so this never
+    // runs off the end of the pool.
+    if (next_physical_block->is_free()) {
+        removeFromFreeList(next_physical_block); // Remove the merged block from the free list.
+        block_to_free->set_size(block_to_free->size() + next_physical_block->size()); // Merge sizes.
+    }
+
+    // 2. Coalesce with the block physically to the left.
+    // If it is free, its boundary tag sits just before our header and tells us
+    // where it starts.
+    if (block_to_free->prev_free()) {
+        const size_t left_size = *(BlockWord*)((char*)block_to_free - sizeof(BlockWord));
+        FreeBlock* left_block = (FreeBlock*)((char*)block_to_free - left_size);
+        const size_t merged_size = left_block->size() + block_to_free->size();
+        if (sharesFreeList(left_block->size(), merged_size)) {
+            // The left block is already on the right list, so just grow it.
+            m_free_bytes += block_to_free->size();
+            noteFreeRemoved(left_block->size());
+            noteFreeAdded(merged_size);
+            left_block->set_size(merged_size);
+            markFree(left_block);
+        } else {
+            // The merged block has moved up a size class.
+            removeFromFreeList(left_block);
+            left_block->set_size(merged_size);
+            addToFreeList(left_block);
+        }
+        return;
+    }
+
+    // If no coalescing happened with the left block, add the current block to the free list.
+    addToFreeList(block_to_free);
+}
+
+bool Allocator::growPool(size_t total_size, bool exact) {
+    if (!m_memory_pool) {
+        return false;
+    }
+
+    // A free block at the end of the pool will merge with the new space, so
+    // only the difference has to be added.
+    BlockHeader* epilogue = (BlockHeader*)(m_heap_start + m_pool_size);
+    const size_t tail_free = epilogue->prev_free() ? *(BlockWord*)((char*)epilogue - sizeof(BlockWord)) : 0;
+    const size_t needed = std::max(total_size > tail_free ? total_size - tail_free : 0, MIN_BLOCK_SIZE);
+
+    // Grow by at least the current pool size, so repeated growth stays cheap,
+    // or with 'exact' by just what is needed, up to the end of its last page;
+    // but never past the end of the reservation.
+    const size_t max_growth = ((m_reserved_size - BLOCK_GRANULE) & ~(BLOCK_GRANULE - 1)) - m_pool_size;
+    size_t growth = (std::max(needed, m_pool_size) + BLOCK_GRANULE - 1) & ~(BLOCK_GRANULE - 1);
+    if (exact) {
+        growth = os_round_to_pages(BLOCK_GRANULE + m_pool_size + needed) - (BLOCK_GRANULE + m_pool_size);
+    }
+    growth = std::min(growth, max_growth);
+    if (growth < needed) {
+        return false;
+    }
+
+    // Commit the pages the new blocks and the new epilogue land on.
+    const size_t committed = os_round_to_pages(BLOCK_GRANULE + m_pool_size + growth);
+    if (committed > m_committed_size) {
+        if (!os_commit((char*)m_memory_pool + m_committed_size, committed - m_committed_size)) {
+            return false;
+        }
+        m_committed_size = committed;
+    }
+
+    // The old epilogue becomes the header of an allocated block spanning the new
+    // space; releasing that block coalesces it with a free tail across the
+    // boundary between the old and new space.
+    FreeBlock* new_block = (FreeBlock*)epilogue;
+    new_block->set_size(growth);
+    m_pool_size += growth;
+    ((BlockHeader*)(m_heap_start + m_pool_size))->size_and_flags = 0;
+    releaseBlock(new_block);
+    return true;
+}
+
+bool Allocator::recover() {
+    clearFreeLists();
+    if (!m_memory_pool) {
+        return false;
+    }
+
+    // Splitting writes the new block's header before shrinking the old block,
+    // so the sizes chain from the first block to the epilogue at every point.
+    // Runs of free blocks are merged into one block as they are found.
+    char* const heap_end = m_heap_start + m_pool_size;
+    FreeBlock* free_run = nullptr;
+    char* current = m_heap_start;
+    while (current < heap_end) {
+        BlockHeader* block = (BlockHeader*)current;
+        const size_t size = block->size();
+        if (size < MIN_BLOCK_SIZE || size % BLOCK_GRANULE != 0 || size > (size_t)(heap_end - current)) {
+            std::cerr << "Corrupt block header found while recovering the pool." << std::endl;
+            clearFreeLists();
+            return false;
+        }
+
+        if (block->is_free()) {
+            if (!free_run) {
+                free_run = (FreeBlock*)block;
+            }
+        } else {
+            block->set_prev_free(false);
+            if (free_run) {
+                free_run->set_word((BlockWord)(current - (char*)free_run));
+                addToFreeList(free_run);
+                free_run = nullptr;
+            }
+        }
+        current += size;
+    }
+
+    BlockHeader* epilogue = (BlockHeader*)heap_end;
+    epilogue->size_and_flags = 0;
+    if (free_run) {
+        free_run->set_word((BlockWord)(heap_end - (char*)free_run));
+        addToFreeList(free_run);
+    }
+    return true;
+}
+
+void Allocator::noteAllocation() {
+    ++m_allocation_count;
+    m_peak_allocated_bytes = std::max(m_peak_allocated_bytes, m_pool_size - m_free_bytes);
+}
+
+template <typename Fn>
+void Allocator::forEachFreeBlock(Fn&& fn) {
+    if (m_policy == FitPolicy::BestFit) {
+        forEachTreeBlock(linked(m_free_lists[0]), fn);
+        return;
+    }
+    for (size_t index = 0; index < NUM_FREE_LISTS; ++index) {
+        for (FreeBlock* block = linked(m_free_lists[index]); block; block = linked(block->next)) {
+            fn(block);
+        }
+    }
+}
+
+size_t Allocator::purgeFreeBlocks(bool only_aged) {
+    const uintptr_t page_mask = os_page_size() - 1;
+    size_t released = 0;
+    forEachFreeBlock([&](FreeBlock* block) {
+        if (block->has_flag(BlockHeader::PURGED)) {
+            return;
+        }
+        if (only_aged && !block->has_flag(BlockHeader::AGED)) {
+            block->set_flag(BlockHeader::AGED, true);
+            return;
+        }
+
+        // Only the whole pages between the free-list links and the boundary tag
+        // can go; the rest of the block must stay readable.
+        const uintptr_t start = ((uintptr_t)block + sizeof(FreeBlock) + page_mask) & ~page_mask;
+        const uintptr_t end = ((uintptr_t)block + block->size() - sizeof(BlockWord)) & ~page_mask;
+        if (end > start && os_purge((void*)start, end - start, m_purge_mode == PurgeMode::Lazy)) {
+            released += end - start;
+        }
+        block->set_flag(BlockHeader::PURGED, true);
+    });
+    return released;
+}
+
+size_t Allocator::purge() {
+    return purgeFreeBlocks(false);
+}
+
+void Allocator::set_purge_policy(PurgeMode mode, std::chrono::milliseconds decay) {
+    m_purge_mode = mode;
+    m_purge_decay = decay;
+    m_last_decay_tick = std::chrono::steady_clock::now();
+    m_frees_until_decay_check = PURGE_CHECK_INTERVAL;
+}
+
+AllocatorStats Allocator::stats() const {
+    if (m_largest_free_stale) {
+        m_largest_free_block = 0;
+        m_free_bound = 0;
+        if (m_policy == FitPolicy::BestFit) {
+            // The largest block is the rightmost node of the tree. Every other
+            // block is no larger, which is as tight a bound as a walk down the
+            // right spine can give.
+            for (FreeBlock* node = linked(m_free_lists[0]); node; node = linked(node->right)) {
+                m_largest_free_block = m_free_bound = node->size();
+            }
+        } else {
+            // With the bitmap policies, the largest block is on the highest
+            // non-empty list, so only that list needs scanning. Every block on
+            // a lower list is smaller than the first size of that list.
+            size_t index = 0;
+            if (m_policy == FitPolicy::SegregatedFit && m_fl_bitmap) {
+                index = 63 - __builtin_clzll(m_fl_bitmap);
+                m_free_bound = size_t(1) << index;
+            } else if (m_policy == FitPolicy::TLSF && m_fl_bitmap) {
+                const size_t fl = 63 - __builtin_clzll(m_fl_bitmap);
+                const size_t sl = 31 - __builtin_clz(m_sl_bitmap[fl]);
+                index = fl * TLSF_SL_COUNT + sl;
+                m_free_bound = fl == 0 ? sl * (TLSF_SMALL_BLOCK / TLSF_SL_COUNT)
+                                       : (TLSF_SL_COUNT | sl) << (fl + TLSF_FL_SHIFT - 1 - TLSF_SL_LOG2);
+            }
+            for (FreeBlock* block = linked(m_free_lists[index]); block; block = linked(block->next)) {
+                const size_t size = block->size();
+                m_free_bound = std::max(m_free_bound, std::min(size, m_largest_free_block));
+                m_largest_free_block = std::max(m_largest_free_block, size);
+            }
+        }
+        m_largest_free_stale = false;
+    }
+
+    AllocatorStats stats;
+    stats.pool_bytes = m_pool_size;
+    stats.allocated_bytes = m_pool_size - m_free_bytes;
+    stats.free_bytes = m_free_bytes;
+    stats.peak_allocated_bytes = m_peak_allocated_bytes;
+    stats.allocation_count = m_allocation_count;
+    stats.free_count = m_free_count;
+    stats.free_block_count = m_free_block_count;
+    stats.largest_free_block = m_largest_free_block;
+    stats.external_fragmentation =
+        m_free_bytes ? 1.0 - (double)m_largest_free_block / (double)m_free_bytes : 0.0;
+    return stats;
+}
+
+size_t Allocator::usable_size(const void* ptr) const {
+    const BlockHeader* block = (const BlockHeader*)((const char*)ptr - sizeof(BlockHeader));
+    return block->size() - sizeof(BlockHeader);
+}
+
+void Allocator::print_free_list() const {
+    std::cout << "--- Free List Status ---" << std::endl;
+    const bool single_list = m_policy == FitPolicy::FirstFit || m_policy == FitPolicy::BestFit;
+    if (single_list ? m_free_lists[0] == NULL_LINK : m_fl_bitmap == 0) {
+        std::cout << "[EMPTY]" << std::endl;
+        return;
+    }
+
+    int i = 0;
+    if (m_policy == FitPolicy::BestFit) {
+        // The tree is printed in order, smallest block first.
+        forEachTreeBlock(linked(m_free_lists[0]), [&i](FreeBlock* current) {
+            std::cout << "Block " << std::setw(2) << i++
+                      << ": Address = " << current
+                      << ", Size = " << std::setw(5) << current->size() << " bytes" << std::endl;
+        });
+        std::cout << "------------------------" << std::endl << std::endl;
+        return;
+    }
+
+    for (size_t index = 0; index < NUM_FREE_LISTS; ++index) {
+        FreeBlock* current = linked(m_free_lists[index]);
+        if (current && m_policy == FitPolicy::SegregatedFit) {
+            std::cout << "Class 2^" << index << ":" << std::endl;
+        } else if (current && m_policy == FitPolicy::TLSF) {
+            std::cout << "List [" << index / TLSF_SL_COUNT << ", " << index % TLSF_SL_COUNT << "]:" << std::endl;
+        }
+
+        while (current) {
+            std::cout << "Block " << std::setw(2) << i++
+                      << ": Address = " << current
+                      << ", Size = " << std::setw(5) << current->size() << " bytes" << std::endl;
+            current = linked(current->next);
+        }
+
+        if (m_policy == FitPolicy::FirstFit) {
+            break;
+        }
+    }
+    std::cout << "------------------------" << std::endl << std::endl;
+}
@@ -0,0 +1,525 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <iostream>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <chrono>
+
+class AllocationTrace;
+
+// =================================================================================
+// Compact metadata (ALLOCATOR_COMPACT_LINKS)
+//
+// By default a block's header and boundary tag are each a size_t and the
+// free-list links are pointers. Built with ALLOCATOR_COMPACT_LINKS (make
+// COMPACT=1), they are 32 bits wide instead: the size word counts the block in
+// granules (shifted up past the flag bits, so it still reads as bytes), and a
+// link is the linked block's offset from the start of the pool, 0 meaning none.
+// An allocation then costs 4 bytes of header instead of 8, the smallest block
+// shrinks from 32 bytes to 16, and nothing stored in the pool is an absolute
+// address, so the pool's contents stay valid wherever it is mapped. The price
+// is that a pool can reserve at most 4 GiB.
+// =================================================================================
+struct FreeBlock;
+#ifdef ALLOCATOR_COMPACT_LINKS
+static constexpr bool COMPACT_LINKS = true;
+using BlockWord = uint32_t;
+using FreeLink = uint32_t;
+#else
+static constexpr bool COMPACT_LINKS = false;
+using BlockWord = size_t;
+using FreeLink = FreeBlock*;
+#endif
+
+// The link that refers to no block: the end of a list or an empty subtree.
+static constexpr FreeLink NULL_LINK = FreeLink();
+
+// =================================================================================
+// BlockHeader: Metadata for each memory block
+//
+// This struct is the core of our memory management. It's placed at the beginning
+// of every memory block (both allocated and free) and is a single word: block
+// sizes are always a multiple of BLOCK_GRANULE, so the low bits of the size are
+// free to hold the block's flags. An allocated block carries nothing else.
+//
+// The clever part is that the linked list pointers for the free list are stored
+// within the free blocks themselves (see FreeBlock), in the space that is the
+// payload while the block is allocated, so we don't waste extra space. Free
+// blocks also end with a boundary tag: a copy of their size in the last word
+// of the block. Together with PREV_FREE this lets deallocate step to the
+// physically previous block in constant time instead of searching for it.
+// =================================================================================
+struct BlockHeader {
+    static constexpr BlockWord IS_FREE = 1;    // This block is free.
+    static constexpr BlockWord PREV_FREE = 2;  // The block physically before this one is free.
+    static constexpr BlockWord PURGED = 4;     // Free, and its interior pages were given back to the OS.
+    static constexpr BlockWord AGED = 8;       // Free and untouched since the last decay tick.
+    static constexpr BlockWord FLAG_MASK = IS_FREE | PREV_FREE | PURGED | AGED;
+
+    BlockWord size_and_flags;  // The size of this block (including the header), ORed with the flags.
+
+    // The word is read and written with relaxed atomics (plain loads and stores
+    // on common hardware): ConcurrentAllocator reads an allocated block's size
+    // without holding the pool lock, while freeing a neighbour under the lock
+    // may flip the block's PREV_FREE bit.
+    BlockWord word() const { return __atomic_load_n(&size_and_flags, __ATOMIC_RELAXED); }
+    void set_word(BlockWord word) { __atomic_store_n(&size_and_flags, word, __ATOMIC_RELAXED); }
+
+    size_t size() const { return word() & ~FLAG_MASK; }
+    bool is_free() const { return word() & IS_FREE; }
+    bool prev_free() const { return word() & PREV_FREE; }
+
+    bool has_flag(BlockWord flag) const { return word() & flag; }
+
+    void set_size(size_t size) { set_word((BlockWord)size | (word() & FLAG_MASK)); }
+    void set_flag(BlockWord flag, bool on) { set_word(on ? (word() | flag) : (word() & ~flag)); }
+    void set_free(bool free) { set_flag(IS_FREE, free); }
+    void set_prev_free(bool free) { set_flag(PREV_FREE, free); }
+};
+
+// FreeBlock: The layout of a block while it is on a free list. Under BestFit
+// the free blocks form a tree instead, and the same two links are the block's
+// children. Links are turned into blocks by Allocator, which knows the pool
+// base they are relative to in the compact configuration.
+struct FreeBlock : BlockHeader {
+    union {
+        FreeLink next;  // The next block in the *free list*.
+        FreeLink left;  // BestFit: the subtree of smaller blocks.
+    };
+    union {
+        FreeLink prev;  // The previous block in the *free list*.
+        FreeLink right; // BestFit: the subtree of larger blocks.
+    };
+};
+
+// Every block size is a multiple of BLOCK_GRANULE, which leaves the low bits of
+// the size word clear for the flags. Blocks start BLOCK_GRANULE - sizeof(BlockHeader)
+// bytes past a granule boundary, so every payload is aligned for any fundamental
+// type (max_align_t).
+static constexpr size_t BLOCK_GRANULE = alignof(std::max_align_t);
+static_assert(BlockHeader::FLAG_MASK < BLOCK_GRANULE, "flags must fit below the granule");
+
+// The smallest block we ever create: room for the free-list links and the
+// boundary tag it needs once it is freed.
+static constexpr size_t MIN_BLOCK_SIZE = sizeof(FreeBlock) + sizeof(BlockWord);
+static_assert(MIN_BLOCK_SIZE % BLOCK_GRANULE == 0, "blocks must stay granule-sized");
+
+// =================================================================================
+// FitPolicy: How the free blocks are indexed and searched
+//
+// FirstFit keeps every free block on one list and walks it from the front.
+// SegregatedFit buckets free blocks into power-of-two size classes (class k holds
+// blocks of [2^k, 2^(k+1)) bytes) and keeps a bitmap of the non-empty classes, so
+// a suitable block is usually found with a single find-first-set and a list pop.
+// TLSF (Two-Level Segregated Fit) splits every power-of-two class again into
+// TLSF_SL_COUNT linear sub-classes, with one bitmap per level. Requests are
+// rounded up to the next sub-class boundary so that any block on the list found
+// by the two bitmap lookups fits: allocate and deallocate never walk a list,
+// which bounds their worst-case latency.
+// BestFit keeps the free blocks in a balanced search tree ordered by size and
+// then address, and takes the smallest block that fits, the lowest-addressed
+// one among equals. Lookups, insertions and removals take O(log n) time, and
+// the tight fits leave large blocks whole for longer than FirstFit does.
+// =================================================================================
+enum class FitPolicy {
+    FirstFit,
+    SegregatedFit,
+    TLSF,
+    BestFit
+};
+
+// TLSF geometry: each power-of-two class is split into 2^TLSF_SL_LOG2 lists.
+// Sizes below TLSF_SMALL_BLOCK share first-level list 0, split linearly.
+static constexpr unsigned TLSF_SL_LOG2 = 4;
+static constexpr unsigned TLSF_SL_COUNT = 1u << TLSF_SL_LOG2;
+static constexpr unsigned TLSF_FL_SHIFT = TLSF_SL_LOG2 + 3;
+static constexpr size_t TLSF_SMALL_BLOCK = size_t(1) << TLSF_FL_SHIFT;
+static constexpr unsigned TLSF_FL_COUNT = 64 - TLSF_FL_SHIFT + 1;
+
+// =================================================================================
+// AllocatorStats: A snapshot of an allocator's usage
+//
+// All sizes are in bytes and count whole blocks, headers and padding included,
+// so allocated_bytes + free_bytes == pool_bytes.
+// =================================================================================
+struct AllocatorStats {
+    size_t pool_bytes;             // Current size of the pool.
+    size_t allocated_bytes;        // Bytes in allocated blocks.
+    size_t free_bytes;             // Bytes in free blocks.
+    size_t peak_allocated_bytes;   // The most allocated_bytes has ever been.
+    size_t allocation_count;       // Successful allocations so far.
+    size_t free_count;             // Deallocations so far.
+    size_t free_block_count;       // Blocks on the free lists.
+    size_t largest_free_block;     // Size of the largest free block.
+
+    // External fragmentation: the share of free memory that is not in the
+    // largest free block, 1 - largest_free_block / free_bytes. 0 means all free
+    // memory is one block; values near 1 mean it is scattered in small pieces.
+    double external_fragmentation;
+};
+
+// =================================================================================
+// PurgeMode: How purge() gives pages back to the OS
+//
+// DontNeed (MADV_DONTNEED) drops the pages at once, so RSS falls immediately.
+// Lazy (MADV_FREE) only lets the kernel reclaim them under memory pressure,
+// which is cheaper when the memory is likely to be reused soon.
+// =================================================================================
+enum class PurgeMode {
+    DontNeed,
+    Lazy
+};
+
+// =================================================================================
+// HeapBlock: One block of a pool, as Allocator::walk reports it
+// =================================================================================
+struct HeapBlock {
+    size_t offset;        // Where the block starts, in bytes from the first block.
+    size_t size;          // The whole block, header included.
+    const void* payload;  // The pointer allocate returned, if the block is allocated.
+    bool free;
+    bool purged;          // Free, and its interior pages were given back to the OS.
+};
+
+// =================================================================================
+// Allocator Class
+//
+// This class encapsulates all the logic for memory management. It requests a large
+// chunk of memory from the OS upon creation and then manages it internally.
+// =================================================================================
+class Allocator {
+public:
+    // Constructor: Initializes the memory pool with room for pool_size bytes of
+    // blocks. If max_pool_size is larger, that much address space is reserved
+    // up front and the pool grows into it on demand instead of running out.
+    Allocator(size_t pool_size, FitPolicy policy = FitPolicy::FirstFit, size_t max_pool_size = 0);
+
+    // Constructor (placed): Manages 'size' bytes of memory the caller provides,
+    // such as a shared or file mapping, instead of reserving its own. The
+    // memory must be aligned to BLOCK_GRANULE and outlive the Allocator, which
+    // never grows the pool and never releases the memory.
+    Allocator(void* memory, size_t size, FitPolicy policy = FitPolicy::FirstFit);
+
+    // Destructor: Releases the memory pool back to the OS.
+    ~Allocator();
+
+    // The pool is owned by exactly one Allocator.
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+
+    // allocate: The custom 'malloc' implementation. The returned memory is
+    // aligned for any fundamental type.
+    void* allocate(size_t size);
+
+    // try_allocate: Like allocate, but running out of memory is not reported,
+    // for front ends that have somewhere else to look when the pool is full.
+    void* try_allocate(size_t size);
+
+    // aligned_allocate: Like allocate, but the returned memory is aligned to
+    // 'alignment', which must be a power of two (e.g. 64 for a cache line or
+    // 4096 for a page). Any padding in front of the aligned block is returned
+    // to the free list rather than wasted.
+    void* aligned_allocate(size_t size, size_t alignment);
+
+    // try_aligned_allocate: aligned_allocate without reporting running out of
+    // memory, as try_allocate is to allocate.
+    void* try_aligned_allocate(size_t size, size_t alignment);
+
+    // deallocate: The custom 'free' implementation.
+    void deallocate(void* ptr);
+
+    // deallocate (sized): Like deallocate, for callers that know the size they
+    // asked for (the size passed to allocate, aligned_allocate or the last
+    // reallocate), as sized operator delete and container allocators do. The
+    // size is checked against the block, and a block whose size does not match
+    // is reported and not freed.
+    void deallocate(void* ptr, size_t size);
+
+    // reallocate: The custom 'realloc' implementation. Resizes the block at ptr
+    // in place when it can: shrinking splits off the tail, and growing absorbs
+    // a free block physically to the right. Otherwise the contents move to a
+    // new block, which is only aligned as allocate's are. A block at the end of
+    // the pool is only grown in place, by extending the pool just enough, when
+    // no free block elsewhere can take it. A null ptr allocates and a new_size of 0
+    // frees. On failure returns nullptr and leaves the old block untouched.
+    void* reallocate(void* ptr, size_t new_size);
+
+    // try_reallocate: reallocate without reporting running out of memory, for
+    // front ends that can move the block to another pool instead.
+    void* try_reallocate(void* ptr, size_t new_size);
+
+    // usable_size: How many bytes the caller may use at ptr, which must have
+    // come from this allocator. This is at least the size that was requested.
+    size_t usable_size(const void* ptr) const;
+
+    // owns: True if ptr points into this allocator's pool. It tests the whole
+    // reservation the pool may grow into, which is fixed at construction, so
+    // other threads may call it while the pool grows.
+    bool owns(const void* ptr) const {
+        return (const char*)ptr >= m_heap_start && (const char*)ptr < (const char*)m_memory_pool + m_reserved_size;
+    }
+
+    // rebase: Point a placed Allocator at its memory's new address, for pools
+    // that are mapped at different addresses over time or by different
+    // processes. Only the compact build (ALLOCATOR_COMPACT_LINKS) keeps no
+    // absolute addresses in the pool; otherwise the address must not change.
+    void rebase(void* memory);
+
+    // recover: Rebuild the free lists from the block headers, for a pool whose
+    // lists may be inconsistent because a process stopped part way through an
+    // operation on it. Every block marked free goes back on the free lists,
+    // merged with free neighbours; a block that was being freed at the time is
+    // lost. Returns false, leaving the pool unusable, if the headers themselves
+    // do not add up to the pool.
+    bool recover();
+
+    // print_free_list: A utility to visualize the state of our free list.
+    void print_free_list() const;
+
+    // walk: Call fn(const HeapBlock&) on every block of the pool, allocated and
+    // free, in address order. The walk follows the block sizes in the headers
+    // from the first block to the epilogue, so it sees the pool exactly as it
+    // is laid out. The pool must not change while it runs.
+    template <typename Fn>
+    void walk(Fn&& fn) const;
+
+    // stats: Current usage counters. They are kept up to date by allocate and
+    // deallocate, so this does not walk the pool. Only after the largest free
+    // block is allocated whole, or split below the next largest, does it look
+    // for the new one (see m_free_bound).
+    AllocatorStats stats() const;
+
+    // purge: Give the memory of free blocks back to the OS. Only whole pages
+    // inside a free block are released; its header, free-list links and
+    // boundary tag stay resident, so coalescing still works. Returns the number
+    // of bytes released.
+    size_t purge();
+
+    // set_purge_policy: Choose how purged pages are released and whether free
+    // memory is purged automatically. With a non-zero decay, deallocate
+    // periodically purges free blocks that have gone untouched for at least
+    // one decay period, so memory freed after a load spike drifts back to the
+    // OS while recently freed blocks stay warm for reuse.
+    void set_purge_policy(PurgeMode mode, std::chrono::milliseconds decay = std::chrono::milliseconds(0));
+
+    // set_trace: Record every successful allocate, aligned_allocate, reallocate
+    // and deallocate call to 'trace' from now on, or stop with nullptr. One
+    // trace may serve several allocators; it must outlive them or be detached.
+    void set_trace(AllocationTrace* trace) { m_trace = trace; }
+
+private:
+    // One power-of-two class per bit of size_t, so every possible block size has
+    // a class; TLSF needs a list per (first level, second level) pair.
+    static constexpr size_t NUM_SIZE_CLASSES = 64;
+    static constexpr size_t NUM_FREE_LISTS = TLSF_FL_COUNT * TLSF_SL_COUNT;
+
+    // The pool is a reserved range of address space of which only the first
+    // m_committed_size bytes are usable. It holds a little padding, so that the
+    // first payload is granule aligned, then m_pool_size bytes of blocks starting
+    // at m_heap_start, then an epilogue: a header of size 0 that is never free, so
+    // the last block's right neighbour always exists and tracks PREV_FREE for it.
+    void* m_memory_pool;
+    size_t m_reserved_size;
+    size_t m_committed_size;
+    char* m_heap_start;
+    size_t m_pool_size;
+    bool m_owns_pool;  // False for a placed pool, which is the caller's memory.
+    FitPolicy m_policy;
+
+    // The free lists. FirstFit only uses list 0, SegregatedFit uses one list per
+    // size class and TLSF one per (fl, sl) pair at index fl * TLSF_SL_COUNT + sl.
+    // BestFit keeps the root of its tree in m_free_lists[0].
+    //
+    // The tree is a treap: a binary search tree on (size, address) that is also
+    // a heap on a priority hashed from each block's address. The random-looking
+    // priorities keep it balanced in expectation, and since the priority is
+    // derived rather than stored, a node needs no more than its two child links,
+    // so BestFit blocks are no bigger than anyone else's.
+    FreeLink m_free_lists[NUM_FREE_LISTS];
+
+    // Bit k of m_fl_bitmap is set while size class k (SegregatedFit) or first
+    // level k (TLSF) has a free block; m_sl_bitmap[k] does the same for the
+    // second-level lists of TLSF first level k.
+    uint64_t m_fl_bitmap;
+    uint32_t m_sl_bitmap[TLSF_FL_COUNT];
+
+    // Usage counters for stats(). allocated_bytes is derived from the pool size
+    // and m_free_bytes.
+    //
+    // The largest free block is tracked together with m_free_bound, an upper
+    // bound on every other free block. Splitting the largest block leaves the
+    // remainder the largest as long as it is still at least the bound, and a
+    // block added or merged at or above the bound becomes the largest, so the
+    // value only goes stale when the largest block is taken whole or split
+    // below the bound. While stale, every free block is at most m_free_bound,
+    // and stats() finds the largest again: BestFit from its tree, the bitmap
+    // policies from their highest non-empty list, and FirstFit by scanning its
+    // one list.
+    size_t m_free_bytes;
+    size_t m_free_block_count;
+    size_t m_peak_allocated_bytes;
+    size_t m_allocation_count;
+    size_t m_free_count;
+    mutable size_t m_largest_free_block;
+    mutable size_t m_free_bound;
+    mutable bool m_largest_free_stale;
+
+    // Purging: see set_purge_policy. Free blocks are checked for aging once
+    // every PURGE_CHECK_INTERVAL deallocations, to keep clock reads off the
+    // common path.
+    static constexpr unsigned PURGE_CHECK_INTERVAL = 64;
+    PurgeMode m_purge_mode;
+    std::chrono::steady_clock::duration m_purge_decay;
+    std::chrono::steady_clock::time_point m_last_decay_tick;
+    unsigned m_frees_until_decay_check;
+
+    // Where calls are recorded, if anywhere: see set_trace.
+    AllocationTrace* m_trace;
+
+    // Constructor (delegated): An Allocator with no pool yet.
+    explicit Allocator(FitPolicy policy);
+
+    // initHeap: Lay out the pool as one free block followed by the epilogue.
+    void initHeap(size_t pool_size);
+
+    // clearFreeLists: Empty every free list, along with the bitmaps and the
+    // free-block counters that follow them.
+    void clearFreeLists();
+
+    // sizeClassOf: The class holding blocks of this size, i.e. floor(log2(size)).
+    static size_t sizeClassOf(size_t size);
+
+    // tlsfMapping: The TLSF (first level, second level) lists holding this size.
+    static void tlsfMapping(size_t size, unsigned& fl, unsigned& sl);
+
+    // freeListIndex: The free list a block of this size belongs on.
+    size_t freeListIndex(size_t size) const;
+
+    // linked / linkTo: Follow a free-list link to its block, and make the link
+    // that refers to a block. In the compact configuration links are offsets
+    // from m_memory_pool; otherwise both are no-ops.
+#ifdef ALLOCATOR_COMPACT_LINKS
+    FreeBlock* linked(FreeLink link) const { return link ? (FreeBlock*)((char*)m_memory_pool + link) : nullptr; }
+    FreeLink linkTo(FreeBlock* block) const { return block ? (FreeLink)((char*)block - (char*)m_memory_pool) : NULL_LINK; }
+#else
+    FreeBlock* linked(FreeLink link) const { return link; }
+    FreeLink linkTo(FreeBlock* block) const { return block; }
+#endif
+
+    // removeFromFreeList: Helper to remove a block from the doubly linked free list.
+    void removeFromFreeList(FreeBlock* block);
+
+    // addToFreeList: Helper to add a block to the front of its free list.
+    void addToFreeList(FreeBlock* block);
+
+    // replaceInFreeList: Helper to put new_block in old_block's place on the same list.
+    void replaceInFreeList(FreeBlock* old_block, FreeBlock* new_block);
+
+    // noteFreeAdded / noteFreeRemoved: Keep the largest free block and
+    // m_free_bound in step as a block of 'size' bytes joins or leaves the free
+    // lists (or, for a block that changes size, both).
+    void noteFreeAdded(size_t size);
+    void noteFreeRemoved(size_t size);
+
+    // sharesFreeList: True if a block of size_b can simply take the place of one
+    // of size_a on the free lists. Never true for BestFit, whose tree is ordered
+    // by size.
+    bool sharesFreeList(size_t size_a, size_t size_b) const;
+
+    // treeInsert / treeRemove: Maintain the BestFit treap.
+    void treeInsert(FreeBlock* block);
+    void treeRemove(FreeBlock* block);
+
+    // treeLess / treePriority: The treap's search order and heap priority. The
+    // priority is hashed from the block's offset in the pool rather than its
+    // address, so it does not change if the pool is mapped elsewhere.
+    static bool treeLess(const FreeBlock* a, const FreeBlock* b);
+    uint64_t treePriority(const FreeBlock* block) const;
+
+    // forEachTreeBlock: Call fn on every block of a subtree, smallest first.
+    template <typename Fn>
+    void forEachTreeBlock(FreeBlock* node, Fn&& fn) const;
+
+    // findFirstFit / findSegregatedFit / findTlsfFit / findBestFit: Locate a
+    // free block of at least total_size bytes.
+    FreeBlock* findFirstFit(size_t total_size) const;
+    FreeBlock* findSegregatedFit(size_t total_size) const;
+    FreeBlock* findTlsfFit(size_t total_size) const;
+    FreeBlock* findBestFit(size_t total_size) const;
+
+    // findFreeBlock: Run the search of the configured policy.
+    FreeBlock* findFreeBlock(size_t total_size) const;
+
+    // blockSizeFor: The block size needed to serve a request of 'size' bytes.
+    static size_t blockSizeFor(size_t size);
+
+    // allocateFromBlock: Hand out the front total_size bytes of a free-list block,
+    // splitting off the rest when it is large enough. Returns the payload.
+    void* allocateFromBlock(FreeBlock* block, size_t total_size);
+
+    // releaseBlock: Coalesce an allocated block with its free neighbours and put
+    // the result on the free list.
+    void releaseBlock(FreeBlock* block);
+
+    // trimBlock: Shrink an allocated block to total_size bytes, releasing the
+    // tail if it is large enough to be a block of its own.
+    void trimBlock(BlockHeader* block, size_t total_size);
+
+    // allocateUntraced / deallocateUntraced / resizeBlock: The work of
+    // allocate, deallocate and reallocate (for a non-null ptr and non-zero
+    // size), without recording a trace event, so that the public calls built
+    // on each other are recorded once.
+    void* allocateUntraced(size_t size, bool report_failure = true);
+    void deallocateUntraced(void* ptr);
+    void* resizeBlock(void* ptr, size_t new_size, bool report_failure);
+
+    // alignedAllocate / reallocateWith: aligned_allocate and reallocate, with
+    // or without reporting running out of memory.
+    void* alignedAllocate(size_t size, size_t alignment, bool report_failure);
+    void* reallocateWith(void* ptr, size_t new_size, bool report_failure);
+
+    // noteAllocation: Count a successful allocation towards the usage counters.
+    void noteAllocation();
+
+    // forEachFreeBlock: Call fn on every block on the free lists.
+    template <typename Fn>
+    void forEachFreeBlock(Fn&& fn);
+
+    // purgeFreeBlocks: Release the interior pages of free blocks that are not
+    // purged yet. With only_aged, blocks are purged only if they were already
+    // AGED; every other block is marked AGED for the next tick.
+    size_t purgeFreeBlocks(bool only_aged);
+
+    // growPool: Extend the pool into the reserved address space so that a free
+    // block of at least total_size bytes can exist at its end. The pool at
+    // least doubles unless 'exact' is set. Returns false once the reservation
+    // is used up.
+    bool growPool(size_t total_size, bool exact = false);
+
+    // nextPhysicalBlock: The block that follows this one in the pool (the
+    // epilogue for the last block).
+    BlockHeader* nextPhysicalBlock(BlockHeader* block) const;
+
+    // markFree / markAllocated: Update a block's state, its boundary tag and the
+    // prev_free bit of the block physically after it.
+    void markFree(BlockHeader* block);
+    void markAllocated(BlockHeader* block);
+};
+
+template <typename Fn>
+void Allocator::walk(Fn&& fn) const {
+    const char* const epilogue = m_heap_start + m_pool_size;
+    for (const char* block = m_heap_start; block && block < epilogue;) {
+        const BlockHeader* header = (const BlockHeader*)block;
+        if (header->size() == 0) {
+            break;  // A corrupt header; stop rather than loop forever.
+        }
+        const HeapBlock info = {(size_t)(block - m_heap_start), header->size(), block + sizeof(BlockHeader),
+                                header->is_free(), header->has_flag(BlockHeader::PURGED)};
+        fn(info);
+        block += header->size();
+    }
+}
+
+#endif // ALLOCATOR_H
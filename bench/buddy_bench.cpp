@@ -0,0 +1,162 @@
+#include "../allocator.h"
+#include "../buddy_allocator.h"
+
+#include <algorithm> // for std::max
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// =================================================================================
+// buddy_bench: BuddyAllocator against Allocator's fit policies on the same
+// allocation traces. For each engine it reports throughput, the share of
+// allocated memory lost to headers and rounding (internal fragmentation), the
+// share of free memory outside the largest free block (external
+// fragmentation), and how many allocations failed.
+// =================================================================================
+
+namespace {
+
+const size_t POOL_SIZE = 64 * 1024 * 1024;
+const size_t TRACE_EVENTS = 1000000;
+const size_t SAMPLE_INTERVAL = 1000;
+
+// One event of a trace: allocate 'size' bytes into slot 'slot', or free the
+// slot if size is 0.
+struct Event {
+    size_t slot;
+    size_t size;
+};
+
+// makeTrace: A random sequence of allocations and frees over at most
+// max_live live blocks, with sizes drawn by next_size.
+template <typename SizeFn>
+std::vector<Event> makeTrace(unsigned seed, size_t max_live, SizeFn&& next_size) {
+    std::mt19937 rng(seed);
+    std::vector<Event> trace;
+    std::vector<size_t> live;
+    std::vector<size_t> free_slots;
+    size_t next_slot = 0;
+    while (trace.size() < TRACE_EVENTS) {
+        const bool allocate = live.empty() || (live.size() < max_live && rng() % 2);
+        if (allocate) {
+            size_t slot;
+            if (free_slots.empty()) {
+                slot = next_slot++;
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+            }
+            live.push_back(slot);
+            trace.push_back({slot, next_size(rng)});
+        } else {
+            const size_t index = rng() % live.size();
+            trace.push_back({live[index], 0});
+            free_slots.push_back(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+    }
+    for (size_t slot : live) {
+        trace.push_back({slot, 0});
+    }
+    return trace;
+}
+
+size_t slotCount(const std::vector<Event>& trace) {
+    size_t slots = 0;
+    for (const Event& event : trace) {
+        slots = std::max(slots, event.slot + 1);
+    }
+    return slots;
+}
+
+struct Result {
+    double mops;
+    double internal_fragmentation;
+    double external_fragmentation;
+    size_t failures;
+};
+
+// replay: Run the trace on a fresh engine. With 'sample', fragmentation is
+// measured every SAMPLE_INTERVAL events and averaged; otherwise only the time
+// is taken.
+template <typename Engine, typename MakeEngine>
+Result replay(const std::vector<Event>& trace, MakeEngine&& make_engine, bool sample) {
+    Engine* engine = make_engine();
+    std::vector<void*> slots(slotCount(trace), nullptr);
+    std::vector<size_t> sizes(slots.size(), 0);
+    Result result = {0.0, 0.0, 0.0, 0};
+    size_t requested = 0;
+    size_t samples = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const Event& event = trace[i];
+        if (event.size) {
+            slots[event.slot] = engine->allocate(event.size);
+            if (slots[event.slot]) {
+                sizes[event.slot] = event.size;
+                requested += event.size;
+            } else {
+                ++result.failures;
+            }
+        } else if (slots[event.slot]) {
+            engine->deallocate(slots[event.slot]);
+            slots[event.slot] = nullptr;
+            requested -= sizes[event.slot];
+        }
+
+        if (sample && i % SAMPLE_INTERVAL == 0) {
+            const AllocatorStats stats = engine->stats();
+            if (stats.allocated_bytes) {
+                result.internal_fragmentation += 1.0 - (double)requested / (double)stats.allocated_bytes;
+                result.external_fragmentation += stats.external_fragmentation;
+                ++samples;
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.mops = (double)trace.size() / seconds / 1e6;
+    if (samples) {
+        result.internal_fragmentation /= (double)samples;
+        result.external_fragmentation /= (double)samples;
+    }
+    delete engine;
+    return result;
+}
+
+template <typename Engine, typename MakeEngine>
+void run(const char* name, const std::vector<Event>& trace, MakeEngine&& make_engine) {
+    const Result timed = replay<Engine>(trace, make_engine, false);
+    const Result measured = replay<Engine>(trace, make_engine, true);
+    std::printf("  %-24s %8.1f Mops/s %9.1f%% internal %9.1f%% external %6zu failed\n", name, timed.mops,
+                100.0 * measured.internal_fragmentation, 100.0 * measured.external_fragmentation, timed.failures);
+}
+
+void compareEngines(const char* title, const std::vector<Event>& trace) {
+    std::printf("%s (%zu events)\n", title, trace.size());
+    run<Allocator>("Allocator FirstFit", trace, [] { return new Allocator(POOL_SIZE, FitPolicy::FirstFit); });
+    run<Allocator>("Allocator SegregatedFit", trace, [] { return new Allocator(POOL_SIZE, FitPolicy::SegregatedFit); });
+    run<Allocator>("Allocator TLSF", trace, [] { return new Allocator(POOL_SIZE, FitPolicy::TLSF); });
+    run<Allocator>("Allocator BestFit", trace, [] { return new Allocator(POOL_SIZE, FitPolicy::BestFit); });
+    run<BuddyAllocator>("BuddyAllocator", trace, [] { return new BuddyAllocator(POOL_SIZE); });
+    std::printf("\n");
+}
+
+} // namespace
+
+int main() {
+    // Power-of-two I/O buffers from 512 bytes to 64 KB.
+    compareEngines("Power-of-two buffers", makeTrace(1, 256, [](std::mt19937& rng) {
+        return size_t(512) << (rng() % 8);
+    }));
+
+    // Mostly small objects of arbitrary size, with the odd larger one.
+    compareEngines("Mixed object sizes", makeTrace(2, 10000, [](std::mt19937& rng) {
+        return rng() % 10 ? 8 + rng() % 248 : 256 + rng() % 3840;
+    }));
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "../allocator.h"
+
+#include <algorithm> // for std::max, std::min
+#include <cstdio>
+#include <cstring>   // for std::strcmp
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+// =================================================================================
+// heap_map: How each fit policy lays out a pool over a long run, drawn from
+// Allocator::walk, which visits every block in address order.
+//
+// The workload mixes many short-lived small objects with fewer long-lived
+// larger ones, the pattern that leaves long-lived blocks scattered across the
+// pool. Every SNAPSHOT_INTERVAL allocations the pool is walked, and:
+//
+//   - a row is added to <out>/heap_map_<policy>.ppm, an image with one row per
+//     snapshot and the pool's address range running left to right. Dark is
+//     free memory and the brighter a pixel, the more of it is allocated.
+//   - a line is added to <out>/fragmentation.csv with the pool's usage and
+//     fragmentation at that point, for plotting against the allocation count.
+//   - every ASCII_EVERY snapshots, an ASCII map of the pool is printed.
+//
+//     ./bench/heap_map --out /tmp
+// =================================================================================
+
+namespace {
+
+const size_t POOL_SIZE = 32 * 1024 * 1024;
+const size_t ALLOCATIONS = 1000000;
+const size_t IMAGE_ROWS = 250;
+const size_t SNAPSHOT_INTERVAL = ALLOCATIONS / IMAGE_ROWS;
+const size_t IMAGE_WIDTH = 512;
+const size_t ASCII_WIDTH = 96;
+const size_t ASCII_EVERY = IMAGE_ROWS / 5;
+
+// From emptiest to fullest.
+const char ASCII_SHADES[] = " .:-=+*#%@";
+
+// Snapshot: The pool as one walk saw it.
+struct Snapshot {
+    size_t allocated_bytes;
+    size_t free_bytes;
+    size_t free_blocks;
+    size_t largest_free_block;
+    size_t extent;           // Where the last allocated block ends.
+    std::vector<double> cells;  // The allocated share of each equal slice of the pool.
+};
+
+// snapshot: Walk the pool, dividing it into 'width' slices.
+Snapshot snapshot(const Allocator& allocator, size_t pool_size, size_t width) {
+    Snapshot shot = {0, 0, 0, 0, 0, std::vector<double>(width, 0.0)};
+    const size_t cell_bytes = (pool_size + width - 1) / width;
+    allocator.walk([&](const HeapBlock& block) {
+        if (block.free) {
+            shot.free_bytes += block.size;
+            ++shot.free_blocks;
+            shot.largest_free_block = std::max(shot.largest_free_block, block.size);
+            return;
+        }
+        shot.allocated_bytes += block.size;
+        shot.extent = block.offset + block.size;
+        // Spread the block's bytes over the slices it covers.
+        for (size_t start = block.offset; start < block.offset + block.size;) {
+            const size_t cell = start / cell_bytes;
+            const size_t end = std::min(block.offset + block.size, (cell + 1) * cell_bytes);
+            shot.cells[std::min(cell, width - 1)] += (double)(end - start) / (double)cell_bytes;
+            start = end;
+        }
+    });
+    return shot;
+}
+
+void printAscii(const Snapshot& shot) {
+    std::string line(shot.cells.size(), ' ');
+    for (size_t i = 0; i < shot.cells.size(); ++i) {
+        const size_t shade = std::min<size_t>((size_t)(shot.cells[i] * (sizeof(ASCII_SHADES) - 1)),
+                                              sizeof(ASCII_SHADES) - 2);
+        line[i] = ASCII_SHADES[shade];
+    }
+    std::printf("  |%s|\n", line.c_str());
+}
+
+// Live: A block that is freed once 'death' allocations have been made.
+struct Live {
+    size_t death;
+    void* ptr;
+    size_t size;
+    bool operator>(const Live& other) const { return death > other.death; }
+};
+
+void mapPolicy(const char* name, FitPolicy policy, const std::string& out_dir, FILE* curve) {
+    Allocator allocator(POOL_SIZE, policy);
+    const size_t pool_size = allocator.stats().pool_bytes;
+    std::mt19937 rng(42);
+    std::priority_queue<Live, std::vector<Live>, std::greater<Live>> live;
+    std::vector<unsigned char> image;
+    size_t requested = 0;
+    size_t failures = 0;
+    double external_sum = 0.0;
+
+    std::printf("%s\n", name);
+    for (size_t now = 1; now <= ALLOCATIONS; ++now) {
+        while (!live.empty() && live.top().death <= now) {
+            allocator.deallocate(live.top().ptr);
+            requested -= live.top().size;
+            live.pop();
+        }
+
+        // Nine in ten objects are small and die young; the rest are larger
+        // and live for a long time.
+        const bool long_lived = rng() % 10 == 0;
+        const size_t size = long_lived ? 512 + rng() % 7681 : 16 + rng() % 497;
+        const size_t lifetime = long_lived ? 1 + rng() % 50000 : 1 + rng() % 200;
+        void* ptr = allocator.allocate(size);
+        if (ptr) {
+            live.push({now + lifetime, ptr, size});
+            requested += size;
+        } else {
+            ++failures;
+        }
+
+        if (now % SNAPSHOT_INTERVAL != 0) {
+            continue;
+        }
+        const Snapshot shot = snapshot(allocator, pool_size, IMAGE_WIDTH);
+        const double external = shot.free_bytes ? 1.0 - (double)shot.largest_free_block / (double)shot.free_bytes : 0.0;
+        const double internal = shot.allocated_bytes ? 1.0 - (double)requested / (double)shot.allocated_bytes : 0.0;
+        external_sum += external;
+        std::fprintf(curve, "%s,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%.4f,%.4f\n", name, now, pool_size, requested,
+                     shot.allocated_bytes, shot.free_blocks, shot.largest_free_block, shot.extent, external, internal);
+
+        for (double cell : shot.cells) {
+            const double f = std::min(cell, 1.0);
+            image.push_back((unsigned char)(20 + 235 * f));
+            image.push_back((unsigned char)(20 + 160 * f));
+            image.push_back((unsigned char)(40 + 20 * f));
+        }
+        if ((now / SNAPSHOT_INTERVAL) % ASCII_EVERY == 0) {
+            printAscii(snapshot(allocator, pool_size, ASCII_WIDTH));
+        }
+    }
+
+    const std::string path = out_dir + "/heap_map_" + name + ".ppm";
+    if (FILE* ppm = std::fopen(path.c_str(), "wb")) {
+        std::fprintf(ppm, "P6\n%zu %zu\n255\n", IMAGE_WIDTH, image.size() / (3 * IMAGE_WIDTH));
+        std::fwrite(image.data(), 1, image.size(), ppm);
+        std::fclose(ppm);
+    }
+
+    const Snapshot last = snapshot(allocator, pool_size, 1);
+    std::printf("  %.1f%% external fragmentation on average, extent %zu KB of %zu KB, %zu free blocks, "
+                "%zu failed; map in %s\n\n",
+                100.0 * external_sum / (double)IMAGE_ROWS, last.extent / 1024, pool_size / 1024, last.free_blocks,
+                failures, path.c_str());
+
+    while (!live.empty()) {
+        allocator.deallocate(live.top().ptr);
+        live.pop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string out_dir = ".";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: %s [--out DIR]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::string curve_path = out_dir + "/fragmentation.csv";
+    FILE* curve = std::fopen(curve_path.c_str(), "w");
+    if (!curve) {
+        std::fprintf(stderr, "Could not create %s\n", curve_path.c_str());
+        return 1;
+    }
+    std::fprintf(curve, "policy,allocations,pool_bytes,requested_bytes,allocated_bytes,free_blocks,"
+                        "largest_free_block,extent_bytes,external_fragmentation,internal_fragmentation\n");
+
+    mapPolicy("FirstFit", FitPolicy::FirstFit, out_dir, curve);
+    mapPolicy("SegregatedFit", FitPolicy::SegregatedFit, out_dir, curve);
+    mapPolicy("TLSF", FitPolicy::TLSF, out_dir, curve);
+    mapPolicy("BestFit", FitPolicy::BestFit, out_dir, curve);
+
+    std::fclose(curve);
+    std::printf("Fragmentation curves in %s\n", curve_path.c_str());
+    return 0;
+}
@@ -0,0 +1,230 @@
+#include "../allocator.h"
+
+#include <algorithm> // for std::min, std::nth_element
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>   // for std::malloc, std::free, std::realloc
+#include <random>
+#include <vector>
+
+// =================================================================================
+// micro_bench: Allocation microbenchmarks for each fit policy and for the
+// system malloc. Every workload is a fixed operation sequence generated from a
+// constant seed, so runs are reproducible and every engine sees exactly the
+// same calls. For each engine it reports throughput, taken as the best of
+// several untimed runs, and the 50th, 99th and 99.9th percentile latency of a
+// single call, from a separate run that reads the clock around every call.
+// Latencies include the cost of reading the clock, which is printed first.
+// =================================================================================
+
+namespace {
+
+const size_t POOL_SIZE = 64 * 1024 * 1024;
+const size_t MAX_POOL_SIZE = 1024 * 1024 * 1024;
+const size_t WORKLOAD_OPS = 1000000;
+const int THROUGHPUT_RUNS = 3;
+
+typedef std::chrono::steady_clock Clock;
+
+enum class OpKind { Allocate, Free, Reallocate };
+
+// One call: allocate or reallocate 'size' bytes into slot 'slot', or free it.
+struct Op {
+    OpKind kind;
+    size_t slot;
+    size_t size;
+};
+
+struct Workload {
+    const char* title;
+    std::vector<Op> ops;
+    size_t slots;
+};
+
+// churn: Fill max_live slots, then free a random live block and allocate a
+// new one in its place until the sequence is full.
+template <typename SizeFn>
+Workload churn(const char* title, unsigned seed, size_t max_live, SizeFn&& next_size) {
+    std::mt19937 rng(seed);
+    Workload workload = {title, {}, max_live};
+    for (size_t slot = 0; slot < max_live; ++slot) {
+        workload.ops.push_back({OpKind::Allocate, slot, next_size(rng)});
+    }
+    while (workload.ops.size() + 2 <= WORKLOAD_OPS) {
+        const size_t slot = rng() % max_live;
+        workload.ops.push_back({OpKind::Free, slot, 0});
+        workload.ops.push_back({OpKind::Allocate, slot, next_size(rng)});
+    }
+    for (size_t slot = 0; slot < max_live; ++slot) {
+        workload.ops.push_back({OpKind::Free, slot, 0});
+    }
+    return workload;
+}
+
+// batches: Allocate batch_size blocks, then free them all, newest first (LIFO)
+// or oldest first (FIFO), and repeat.
+Workload batches(const char* title, unsigned seed, size_t batch_size, bool lifo) {
+    std::mt19937 rng(seed);
+    Workload workload = {title, {}, batch_size};
+    while (workload.ops.size() + 2 * batch_size <= WORKLOAD_OPS) {
+        for (size_t slot = 0; slot < batch_size; ++slot) {
+            workload.ops.push_back({OpKind::Allocate, slot, 16 + rng() % 497});
+        }
+        for (size_t i = 0; i < batch_size; ++i) {
+            const size_t slot = lifo ? batch_size - 1 - i : i;
+            workload.ops.push_back({OpKind::Free, slot, 0});
+        }
+    }
+    return workload;
+}
+
+// reallocGrowth: Grow 'buffers' buffers side by side from 16 bytes to 64 KB,
+// each by a quarter at a time as an appending container would, then free them
+// and start over. Neighbours growing at once keep in-place growth from always
+// succeeding.
+Workload reallocGrowth(const char* title, size_t buffers) {
+    const size_t max_size = 64 * 1024;
+    Workload workload = {title, {}, buffers};
+    while (workload.ops.size() < WORKLOAD_OPS) {
+        for (size_t slot = 0; slot < buffers; ++slot) {
+            workload.ops.push_back({OpKind::Allocate, slot, 16});
+        }
+        for (size_t size = 20; size <= max_size; size += size / 4) {
+            for (size_t slot = 0; slot < buffers; ++slot) {
+                workload.ops.push_back({OpKind::Reallocate, slot, size});
+            }
+        }
+        for (size_t slot = 0; slot < buffers; ++slot) {
+            workload.ops.push_back({OpKind::Free, slot, 0});
+        }
+    }
+    return workload;
+}
+
+// SystemMalloc: The C library's heap, behind the same calls as Allocator.
+struct SystemMalloc {
+    void* allocate(size_t size) { return std::malloc(size); }
+    void deallocate(void* ptr) { std::free(ptr); }
+    void* reallocate(void* ptr, size_t new_size) { return std::realloc(ptr, new_size); }
+};
+
+// perform: Make one call of the workload. Each new block is written to, as a
+// program would, which also keeps the compiler from removing the call.
+template <typename Engine>
+inline void perform(Engine& engine, const Op& op, std::vector<void*>& slots) {
+    void*& ptr = slots[op.slot];
+    switch (op.kind) {
+    case OpKind::Allocate:
+        ptr = engine.allocate(op.size);
+        if (ptr) {
+            *(volatile char*)ptr = 1;
+        }
+        break;
+    case OpKind::Free:
+        engine.deallocate(ptr);
+        ptr = nullptr;
+        break;
+    case OpKind::Reallocate:
+        if (void* resized = engine.reallocate(ptr, op.size)) {
+            ptr = resized;
+            *(volatile char*)ptr = 1;
+        }
+        break;
+    }
+}
+
+// throughput: Run the workload on a fresh engine and return millions of
+// calls per second.
+template <typename Engine, typename MakeEngine>
+double throughput(const Workload& workload, MakeEngine&& make_engine) {
+    Engine* engine = make_engine();
+    std::vector<void*> slots(workload.slots, nullptr);
+    const Clock::time_point start = Clock::now();
+    for (const Op& op : workload.ops) {
+        perform(*engine, op, slots);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    delete engine;
+    return (double)workload.ops.size() / seconds / 1e6;
+}
+
+// latencies: Run the workload on a fresh engine, timing every call in
+// nanoseconds.
+template <typename Engine, typename MakeEngine>
+std::vector<uint32_t> latencies(const Workload& workload, MakeEngine&& make_engine) {
+    Engine* engine = make_engine();
+    std::vector<void*> slots(workload.slots, nullptr);
+    std::vector<uint32_t> times;
+    times.reserve(workload.ops.size());
+    for (const Op& op : workload.ops) {
+        const Clock::time_point start = Clock::now();
+        perform(*engine, op, slots);
+        const Clock::duration elapsed = Clock::now() - start;
+        times.push_back((uint32_t)std::min<int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), UINT32_MAX));
+    }
+    delete engine;
+    return times;
+}
+
+// percentile: The value below which 'fraction' of the times fall. Reorders
+// the times.
+uint32_t percentile(std::vector<uint32_t>& times, double fraction) {
+    const size_t index = std::min(times.size() - 1, (size_t)(fraction * (double)times.size()));
+    std::nth_element(times.begin(), times.begin() + index, times.end());
+    return times[index];
+}
+
+template <typename Engine, typename MakeEngine>
+void run(const char* name, const Workload& workload, MakeEngine&& make_engine) {
+    double mops = 0.0;
+    for (int i = 0; i < THROUGHPUT_RUNS; ++i) {
+        mops = std::max(mops, throughput<Engine>(workload, make_engine));
+    }
+    std::vector<uint32_t> times = latencies<Engine>(workload, make_engine);
+    const uint32_t p50 = percentile(times, 0.50);
+    const uint32_t p99 = percentile(times, 0.99);
+    const uint32_t p999 = percentile(times, 0.999);
+    std::printf("  %-24s %8.1f Mops/s %7u ns p50 %7u ns p99 %7u ns p99.9\n", name, mops, p50, p99, p999);
+}
+
+Allocator* makeAllocator(FitPolicy policy) {
+    return new Allocator(POOL_SIZE, policy, MAX_POOL_SIZE);
+}
+
+void compareEngines(const Workload& workload) {
+    std::printf("%s (%zu calls)\n", workload.title, workload.ops.size());
+    run<SystemMalloc>("malloc", workload, [] { return new SystemMalloc(); });
+    run<Allocator>("Allocator FirstFit", workload, [] { return makeAllocator(FitPolicy::FirstFit); });
+    run<Allocator>("Allocator SegregatedFit", workload, [] { return makeAllocator(FitPolicy::SegregatedFit); });
+    run<Allocator>("Allocator TLSF", workload, [] { return makeAllocator(FitPolicy::TLSF); });
+    run<Allocator>("Allocator BestFit", workload, [] { return makeAllocator(FitPolicy::BestFit); });
+    std::printf("\n");
+}
+
+// clockOverhead: The median cost of the two clock reads around each call.
+uint32_t clockOverhead() {
+    std::vector<uint32_t> times(100000);
+    for (uint32_t& time : times) {
+        const Clock::time_point start = Clock::now();
+        time = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+    return percentile(times, 0.50);
+}
+
+} // namespace
+
+int main() {
+    std::printf("Clock overhead included in latencies: %u ns\n\n", clockOverhead());
+
+    compareEngines(churn("Fixed-size churn, 64 bytes", 1, 1000, [](std::mt19937&) { return size_t(64); }));
+    compareEngines(churn("Random-size churn, 16 bytes to 4 KB", 2, 10000, [](std::mt19937& rng) {
+        return size_t(16) + rng() % 4081;
+    }));
+    compareEngines(batches("LIFO frees, batches of 1000", 3, 1000, true));
+    compareEngines(batches("FIFO frees, batches of 1000", 4, 1000, false));
+    compareEngines(reallocGrowth("Realloc growth to 64 KB, 64 buffers", 64));
+
+    return 0;
+}
@@ -0,0 +1,334 @@
+#include "../allocator.h"
+#include "../concurrent_allocator.h"
+#include "../thread_arenas.h"
+
+#include <algorithm> // for std::max
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>   // for std::malloc, std::free, std::strtoul
+#include <cstring>   // for std::strcmp
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>  // for sysconf
+
+// =================================================================================
+// mt_bench: How the thread-safe engines scale with the number of threads,
+// against the system malloc, on three standard stress patterns:
+//
+//   larson             Server threads each keep a set of live blocks, replacing
+//                      a random one per call, and regularly swap their set for
+//                      another, so blocks are freed by a different thread than
+//                      allocated them (after Larson and Krishnan).
+//   producer-consumer  Threads in pairs: one allocates blocks and passes them
+//                      through a queue, the other frees them.
+//   thread-local       Every thread allocates and frees its own blocks only.
+//
+// Each workload runs at 1, 2, 4, ... up to --threads threads (default: the
+// number of CPUs, at least 4). Every thread makes the same number of calls, so
+// a perfectly scaling engine keeps the same time and its throughput grows with
+// the thread count. The resident set size is read before the engine is created
+// and again at the end of the run, before anything is freed; the difference is
+// reported. The system malloc keeps memory from earlier runs, so its figure
+// only shows growth.
+//
+// Results are printed as CSV, or as JSON with --format json, one record per
+// workload, engine and thread count.
+// =================================================================================
+
+namespace {
+
+const size_t CALLS_PER_THREAD = 1000000;
+const size_t POOL_SIZE = 16 * 1024 * 1024;
+const size_t MAX_POOL_SIZE = COMPACT_LINKS ? size_t(3) << 30 : size_t(16) << 30;
+
+const size_t LARSON_BLOCKS = 1000;
+const size_t LARSON_SWAP_INTERVAL = 10000;
+const size_t QUEUE_CAPACITY = 1024;
+const size_t LOCAL_BLOCKS = 256;
+
+struct Result {
+    std::string workload;
+    std::string engine;
+    size_t threads;
+    size_t calls;
+    double seconds;
+    size_t rss_kb;
+};
+
+// SystemMalloc: The C library's heap, behind the same calls as the engines.
+struct SystemMalloc {
+    void* allocate(size_t size) { return std::malloc(size); }
+    void deallocate(void* ptr) { std::free(ptr); }
+};
+
+// residentBytes: The process's current resident set size.
+size_t residentBytes() {
+    size_t pages = 0;
+    size_t resident = 0;
+    if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(statm, "%zu %zu", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        std::fclose(statm);
+    }
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// blockSize: A random request size between 16 and max_size bytes.
+inline size_t blockSize(std::mt19937& rng, size_t max_size) {
+    return 16 + rng() % (max_size - 15);
+}
+
+// allocateBlock: Allocate and touch a block, as a program would.
+template <typename Engine>
+inline void* allocateBlock(Engine& engine, size_t size) {
+    void* ptr = engine.allocate(size);
+    if (ptr) {
+        *(volatile char*)ptr = 1;
+    }
+    return ptr;
+}
+
+// runThreads: Start 'threads' threads running body(index), release them all
+// at once and return how long it took until the last one finished.
+template <typename Body>
+double runThreads(size_t threads, Body&& body) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (size_t index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            body(index);
+        });
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// larson: Each thread starts with its own set of blocks, and every
+// LARSON_SWAP_INTERVAL calls trades it for a random set from a shared table,
+// which the main thread fills beforehand.
+template <typename Engine>
+double larson(Engine& engine, size_t threads, size_t& rss_bytes) {
+    std::vector<std::vector<void*>> sets(2 * threads, std::vector<void*>(LARSON_BLOCKS));
+    std::mt19937 setup_rng(1);
+    for (std::vector<void*>& set : sets) {
+        for (void*& ptr : set) {
+            ptr = allocateBlock(engine, blockSize(setup_rng, 256));
+        }
+    }
+    std::vector<std::vector<void*>*> table;
+    for (size_t i = threads; i < sets.size(); ++i) {
+        table.push_back(&sets[i]);
+    }
+    std::mutex table_lock;
+
+    const double seconds = runThreads(threads, [&](size_t index) {
+        std::mt19937 rng((unsigned)index + 1);
+        std::vector<void*>* set = &sets[index];
+        for (size_t call = 0; call < CALLS_PER_THREAD; call += 2) {
+            void*& ptr = (*set)[rng() % LARSON_BLOCKS];
+            engine.deallocate(ptr);
+            ptr = allocateBlock(engine, blockSize(rng, 256));
+            if (call % LARSON_SWAP_INTERVAL == 0) {
+                std::lock_guard<std::mutex> guard(table_lock);
+                std::swap(set, table[rng() % table.size()]);
+            }
+        }
+    });
+    rss_bytes = residentBytes();
+
+    for (std::vector<void*>& set : sets) {
+        for (void* ptr : set) {
+            engine.deallocate(ptr);
+        }
+    }
+    return seconds;
+}
+
+// Channel: A single-producer, single-consumer queue of blocks.
+struct Channel {
+    alignas(64) std::atomic<size_t> head{0};  // Next slot to read.
+    alignas(64) std::atomic<size_t> tail{0};  // Next slot to write.
+    void* slots[QUEUE_CAPACITY];
+};
+
+// producerConsumer: Even threads allocate, odd threads free what their
+// partner allocated. A thread without a partner does both in batches.
+template <typename Engine>
+double producerConsumer(Engine& engine, size_t threads, size_t& rss_bytes) {
+    std::vector<Channel> channels(threads / 2 + 1);
+    std::atomic<size_t> finished{0};
+
+    const double seconds = runThreads(threads, [&](size_t index) {
+        std::mt19937 rng((unsigned)index + 1);
+        Channel& channel = channels[index / 2];
+        if (index + 1 == threads && threads % 2 == 1) {
+            std::vector<void*> batch(QUEUE_CAPACITY);
+            for (size_t call = 0; call < CALLS_PER_THREAD; call += 2 * batch.size()) {
+                for (void*& ptr : batch) {
+                    ptr = allocateBlock(engine, blockSize(rng, 512));
+                }
+                for (void* ptr : batch) {
+                    engine.deallocate(ptr);
+                }
+            }
+        } else if (index % 2 == 0) {
+            for (size_t call = 0; call < CALLS_PER_THREAD; ++call) {
+                void* ptr = allocateBlock(engine, blockSize(rng, 512));
+                const size_t tail = channel.tail.load(std::memory_order_relaxed);
+                while (tail - channel.head.load(std::memory_order_acquire) == QUEUE_CAPACITY) {
+                    std::this_thread::yield();
+                }
+                channel.slots[tail % QUEUE_CAPACITY] = ptr;
+                channel.tail.store(tail + 1, std::memory_order_release);
+            }
+        } else {
+            for (size_t call = 0; call < CALLS_PER_THREAD; ++call) {
+                const size_t head = channel.head.load(std::memory_order_relaxed);
+                while (channel.tail.load(std::memory_order_acquire) == head) {
+                    std::this_thread::yield();
+                }
+                engine.deallocate(channel.slots[head % QUEUE_CAPACITY]);
+                channel.head.store(head + 1, std::memory_order_release);
+            }
+        }
+        if (finished.fetch_add(1) + 1 == threads) {
+            rss_bytes = residentBytes();
+        }
+    });
+    return seconds;
+}
+
+// threadLocal: Each thread picks a random slot of its own, freeing the block
+// there or allocating one if it is empty.
+template <typename Engine>
+double threadLocal(Engine& engine, size_t threads, size_t& rss_bytes) {
+    std::vector<std::vector<void*>> slots(threads, std::vector<void*>(LOCAL_BLOCKS, nullptr));
+    const double seconds = runThreads(threads, [&](size_t index) {
+        std::mt19937 rng((unsigned)index + 1);
+        std::vector<void*>& own = slots[index];
+        for (size_t call = 0; call < CALLS_PER_THREAD; ++call) {
+            void*& ptr = own[rng() % LOCAL_BLOCKS];
+            if (ptr) {
+                engine.deallocate(ptr);
+                ptr = nullptr;
+            } else {
+                ptr = allocateBlock(engine, blockSize(rng, 1024));
+            }
+        }
+    });
+    rss_bytes = residentBytes();
+
+    for (std::vector<void*>& own : slots) {
+        for (void* ptr : own) {
+            engine.deallocate(ptr);
+        }
+    }
+    return seconds;
+}
+
+template <typename Engine, typename MakeEngine, typename Workload>
+Result run(const char* workload_name, Workload&& workload, const char* engine_name, MakeEngine&& make_engine,
+           size_t threads) {
+    std::fprintf(stderr, "mt_bench: %s, %s, %zu threads\n", workload_name, engine_name, threads);
+    const size_t rss_before = residentBytes();
+    Engine* engine = make_engine(threads);
+    size_t rss_after = rss_before;
+    const double seconds = workload(*engine, threads, rss_after);
+    delete engine;
+    return {workload_name, engine_name, threads, threads * CALLS_PER_THREAD, seconds,
+            (rss_after > rss_before ? rss_after - rss_before : 0) / 1024};
+}
+
+template <typename Workload>
+void compareEngines(const char* name, Workload&& workload, const std::vector<size_t>& thread_counts,
+                    std::vector<Result>& results) {
+    for (size_t threads : thread_counts) {
+        results.push_back(run<SystemMalloc>(name, workload, "malloc", [](size_t) { return new SystemMalloc(); },
+                                            threads));
+        results.push_back(run<ConcurrentAllocator>(name, workload, "ConcurrentAllocator", [](size_t) {
+            return new ConcurrentAllocator(POOL_SIZE, FitPolicy::TLSF, MAX_POOL_SIZE);
+        }, threads));
+        results.push_back(run<ThreadArenas>(name, workload, "ThreadArenas", [](size_t arenas) {
+            return new ThreadArenas(arenas, POOL_SIZE, FitPolicy::TLSF, MAX_POOL_SIZE);
+        }, threads));
+    }
+}
+
+void printCsv(const std::vector<Result>& results) {
+    std::printf("workload,engine,threads,calls,seconds,mops,rss_kb\n");
+    for (const Result& result : results) {
+        std::printf("%s,%s,%zu,%zu,%.6f,%.3f,%zu\n", result.workload.c_str(), result.engine.c_str(), result.threads,
+                    result.calls, result.seconds, (double)result.calls / result.seconds / 1e6, result.rss_kb);
+    }
+}
+
+void printJson(const std::vector<Result>& results) {
+    std::printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        std::printf("  {\"workload\": \"%s\", \"engine\": \"%s\", \"threads\": %zu, \"calls\": %zu, "
+                    "\"seconds\": %.6f, \"mops\": %.3f, \"rss_kb\": %zu}%s\n",
+                    result.workload.c_str(), result.engine.c_str(), result.threads, result.calls, result.seconds,
+                    (double)result.calls / result.seconds / 1e6, result.rss_kb, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("]\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t max_threads = std::max<size_t>(std::thread::hardware_concurrency(), 4);
+    bool json = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            max_threads = std::max<size_t>(std::strtoul(argv[++i], nullptr, 10), 1);
+        } else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            json = std::strcmp(argv[++i], "json") == 0;
+        } else {
+            std::fprintf(stderr, "usage: %s [--threads N] [--format csv|json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<size_t> thread_counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::vector<Result> results;
+    compareEngines("larson", [](auto& engine, size_t threads, size_t& rss) {
+        return larson(engine, threads, rss);
+    }, thread_counts, results);
+    compareEngines("producer-consumer", [](auto& engine, size_t threads, size_t& rss) {
+        return producerConsumer(engine, threads, rss);
+    }, thread_counts, results);
+    compareEngines("thread-local", [](auto& engine, size_t threads, size_t& rss) {
+        return threadLocal(engine, threads, rss);
+    }, thread_counts, results);
+
+    if (json) {
+        printJson(results);
+    } else {
+        printCsv(results);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "../allocator.h"
+#include "../pmr_resource.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+// =================================================================================
+// pmr_bench: Throughput of std::pmr containers on the default resource (the
+// global operator new) against the same containers on an Allocator pool, for
+// each fit policy.
+// =================================================================================
+
+namespace {
+
+const int VECTOR_ROUNDS = 2000;
+const int VECTOR_LENGTH = 10000;
+const int MAP_ROUNDS = 20;
+const int MAP_KEYS = 50000;
+
+// timeMs: Run fn once and return how long it took in milliseconds.
+template <typename Fn>
+double timeMs(Fn&& fn) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// vectorWorkload: Build vectors by appending one element at a time, so every
+// growth step allocates a larger buffer and frees the old one.
+size_t vectorWorkload(std::pmr::memory_resource* resource) {
+    size_t checksum = 0;
+    for (int round = 0; round < VECTOR_ROUNDS; ++round) {
+        std::pmr::vector<int> numbers(resource);
+        for (int i = 0; i < VECTOR_LENGTH; ++i) {
+            numbers.push_back(i + round);
+        }
+        checksum += numbers[round % VECTOR_LENGTH];
+    }
+    return checksum;
+}
+
+// mapWorkload: Fill a hash map, erase every other key and refill it, so node
+// allocations and frees interleave.
+size_t mapWorkload(std::pmr::memory_resource* resource) {
+    size_t checksum = 0;
+    for (int round = 0; round < MAP_ROUNDS; ++round) {
+        std::pmr::unordered_map<int, int> table(resource);
+        for (int key = 0; key < MAP_KEYS; ++key) {
+            table.emplace(key, key + round);
+        }
+        for (int key = 0; key < MAP_KEYS; key += 2) {
+            table.erase(key);
+        }
+        for (int key = 0; key < MAP_KEYS; key += 2) {
+            table.emplace(key, key);
+        }
+        checksum += table.size();
+    }
+    return checksum;
+}
+
+void report(const char* name, double vector_ms, double map_ms) {
+    const double vector_ops = (double)VECTOR_ROUNDS * VECTOR_LENGTH;
+    const double map_ops = (double)MAP_ROUNDS * MAP_KEYS * 2;
+    std::printf("%-24s %10.1f ms %8.1f Mops/s %10.1f ms %8.1f Mops/s\n", name, vector_ms,
+                vector_ops / vector_ms / 1000.0, map_ms, map_ops / map_ms / 1000.0);
+}
+
+} // namespace
+
+int main() {
+    std::printf("%-24s %30s %30s\n", "", "pmr::vector push_back", "pmr::unordered_map insert/erase");
+
+    volatile size_t sink = 0;
+    std::pmr::memory_resource* default_resource = std::pmr::get_default_resource();
+    const double default_vector_ms = timeMs([&] { sink = sink + vectorWorkload(default_resource); });
+    const double default_map_ms = timeMs([&] { sink = sink + mapWorkload(default_resource); });
+    report("default resource", default_vector_ms, default_map_ms);
+
+    const struct {
+        const char* name;
+        FitPolicy policy;
+    } policies[] = {
+        {"Allocator FirstFit", FitPolicy::FirstFit},
+        {"Allocator SegregatedFit", FitPolicy::SegregatedFit},
+        {"Allocator TLSF", FitPolicy::TLSF},
+        {"Allocator BestFit", FitPolicy::BestFit},
+    };
+    for (const auto& entry : policies) {
+        // A small pool that grows on demand inside a 1 GB reservation.
+        Allocator pool(1024 * 1024, entry.policy, 1024 * 1024 * 1024);
+        AllocatorResource<> resource(pool);
+        const double vector_ms = timeMs([&] { sink = sink + vectorWorkload(&resource); });
+        const double map_ms = timeMs([&] { sink = sink + mapWorkload(&resource); });
+        report(entry.name, vector_ms, map_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,312 @@
+#include "../allocation_trace.h"
+#include "../allocator.h"
+#include "../buddy_allocator.h"
+
+#include <algorithm> // for std::max, std::min
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>   // for std::malloc, std::free, std::realloc
+#include <cstring>   // for std::memcpy
+#include <unordered_map>
+#include <vector>
+
+#include <malloc.h>  // for mallinfo2
+
+// =================================================================================
+// trace_replay: Replays a trace recorded by AllocationTrace, for instance from a
+// real program run under liballocator.so with ALLOCATOR_TRACE set, on the
+// system malloc, on a pool with each fit policy and on BuddyAllocator. The
+// recorded calls are made one after another in the order they were recorded,
+// on one thread. For each engine it reports throughput, the largest the heap
+// grew to and the most it had allocated, the share of allocated memory lost to
+// headers and rounding (internal fragmentation), the share of free memory
+// outside the largest free block (external fragmentation), and how many
+// allocations failed.
+//
+//     ./bench/trace_replay /tmp/app.trace.1234
+// =================================================================================
+
+namespace {
+
+const size_t INITIAL_POOL_SIZE = 4 * 1024 * 1024;
+const size_t MAX_POOL_SIZE = COMPACT_LINKS ? size_t(3) << 30 : size_t(64) << 30;
+const size_t MIN_BUDDY_POOL_SIZE = 64 * 1024 * 1024;
+const size_t SAMPLE_INTERVAL = 1000;
+const int THROUGHPUT_RUNS = 3;
+
+enum class OpKind { Allocate, Free, Reallocate };
+
+// One recorded call, with the block it concerns numbered by slot instead of
+// identified by address, so a replay needs no lookups.
+struct Op {
+    OpKind kind;
+    size_t slot;
+    size_t size;
+    size_t alignment;  // 0 for the default.
+};
+
+struct Replay {
+    std::vector<Op> ops;
+    size_t slots;
+    size_t unmatched;             // Frees and reallocations of blocks the trace never allocated.
+    size_t peak_requested_bytes;  // The most bytes the program had asked for at once.
+};
+
+// translate: Turn the events into slot-numbered calls. A trace may start
+// after some blocks were allocated, or lose events, so calls on unknown
+// addresses are counted and skipped (a reallocation of one becomes an
+// allocation).
+Replay translate(const std::vector<TraceEvent>& events) {
+    Replay replay = {{}, 0, 0, 0};
+    std::unordered_map<uint64_t, size_t> live;  // Address to slot.
+    std::vector<size_t> sizes;
+    std::vector<size_t> free_slots;
+    size_t requested = 0;
+
+    auto newSlot = [&]() {
+        if (!free_slots.empty()) {
+            const size_t slot = free_slots.back();
+            free_slots.pop_back();
+            return slot;
+        }
+        sizes.push_back(0);
+        return replay.slots++;
+    };
+
+    for (const TraceEvent& event : events) {
+        const auto found = live.find(event.op == TraceEvent::Reallocate ? event.previous : event.address);
+        if (event.op == TraceEvent::Free) {
+            if (found == live.end()) {
+                ++replay.unmatched;
+                continue;
+            }
+            const size_t slot = found->second;
+            replay.ops.push_back({OpKind::Free, slot, 0, 0});
+            requested -= sizes[slot];
+            free_slots.push_back(slot);
+            live.erase(found);
+            continue;
+        }
+
+        size_t slot;
+        OpKind kind = OpKind::Allocate;
+        if (event.op == TraceEvent::Reallocate && found != live.end()) {
+            slot = found->second;
+            kind = OpKind::Reallocate;
+            requested -= sizes[slot];
+            live.erase(found);
+        } else {
+            replay.unmatched += event.op == TraceEvent::Reallocate;
+            slot = newSlot();
+        }
+        const size_t alignment = event.alignment_log2 ? size_t(1) << event.alignment_log2 : 0;
+        replay.ops.push_back({kind, slot, event.size, alignment});
+        sizes[slot] = event.size;
+        requested += event.size;
+        replay.peak_requested_bytes = std::max(replay.peak_requested_bytes, requested);
+        live[event.address] = slot;
+    }
+    return replay;
+}
+
+// SystemMalloc: The C library's heap, behind the same calls as the pools. Its
+// usage comes from mallinfo2, less what the process had before the replay.
+class SystemMalloc {
+public:
+    SystemMalloc() : m_baseline(mallinfo2()) {}
+
+    void* allocate(size_t size) { return std::malloc(size); }
+    void* aligned_allocate(size_t size, size_t alignment) {
+        void* ptr = nullptr;
+        return posix_memalign(&ptr, std::max(alignment, sizeof(void*)), size) == 0 ? ptr : nullptr;
+    }
+    void deallocate(void* ptr) { std::free(ptr); }
+    void* reallocate(void* ptr, size_t, size_t new_size) { return std::realloc(ptr, new_size); }
+
+    // mallinfo2 gives no free-block sizes, so no external fragmentation.
+    static constexpr bool HAS_FRAGMENTATION = false;
+    AllocatorStats stats() const {
+        const struct mallinfo2 info = mallinfo2();
+        AllocatorStats stats = {};
+        stats.pool_bytes = since(info.arena + info.hblkhd, m_baseline.arena + m_baseline.hblkhd);
+        stats.allocated_bytes = since(info.uordblks + info.hblkhd, m_baseline.uordblks + m_baseline.hblkhd);
+        return stats;
+    }
+
+private:
+    struct mallinfo2 m_baseline;
+
+    static size_t since(size_t now, size_t baseline) { return now > baseline ? now - baseline : 0; }
+};
+
+// PoolEngine: An Allocator or BuddyAllocator owned by the replay.
+template <typename Pool>
+class PoolEngine {
+public:
+    template <typename... Args>
+    explicit PoolEngine(Args... args) : m_pool(args...) {}
+
+    void* allocate(size_t size) { return m_pool.allocate(size); }
+    void* aligned_allocate(size_t size, size_t alignment) { return m_pool.aligned_allocate(size, alignment); }
+    void deallocate(void* ptr) { m_pool.deallocate(ptr); }
+    void* reallocate(void* ptr, size_t old_size, size_t new_size) { return resize(m_pool, ptr, old_size, new_size); }
+
+    static constexpr bool HAS_FRAGMENTATION = true;
+    AllocatorStats stats() const { return m_pool.stats(); }
+
+private:
+    Pool m_pool;
+
+    static void* resize(Allocator& pool, void* ptr, size_t, size_t new_size) { return pool.reallocate(ptr, new_size); }
+
+    // BuddyAllocator has no reallocate: move the block as a caller would.
+    static void* resize(BuddyAllocator& pool, void* ptr, size_t old_size, size_t new_size) {
+        void* new_ptr = pool.allocate(new_size);
+        if (new_ptr) {
+            std::memcpy(new_ptr, ptr, std::min(old_size, new_size));
+            pool.deallocate(ptr);
+        }
+        return new_ptr;
+    }
+};
+
+struct Result {
+    double mops;
+    size_t peak_pool_bytes;
+    size_t peak_allocated_bytes;
+    double internal_fragmentation;
+    double external_fragmentation;
+    size_t failures;
+};
+
+// run: Make every call on a fresh engine. With 'sample', usage is read every
+// SAMPLE_INTERVAL calls; otherwise only the time is taken.
+template <typename Engine, typename MakeEngine>
+Result run(const Replay& replay, MakeEngine&& make_engine, bool sample) {
+    Engine* engine = make_engine();
+    std::vector<void*> slots(replay.slots, nullptr);
+    std::vector<size_t> sizes(replay.slots, 0);
+    Result result = {0.0, 0, 0, 0.0, 0.0, 0};
+    size_t requested = 0;
+    size_t samples = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < replay.ops.size(); ++i) {
+        const Op& op = replay.ops[i];
+        void*& ptr = slots[op.slot];
+        if (op.kind == OpKind::Free) {
+            if (ptr) {
+                engine->deallocate(ptr);
+                requested -= sizes[op.slot];
+                ptr = nullptr;
+            }
+        } else {
+            void* const old_ptr = op.kind == OpKind::Reallocate ? ptr : nullptr;
+            void* const new_ptr = old_ptr ? engine->reallocate(old_ptr, sizes[op.slot], op.size)
+                                : op.alignment ? engine->aligned_allocate(op.size, op.alignment)
+                                               : engine->allocate(op.size);
+            if (new_ptr) {
+                requested += op.size - (old_ptr ? sizes[op.slot] : 0);
+                ptr = new_ptr;
+                sizes[op.slot] = op.size;
+            } else {
+                ++result.failures;
+            }
+        }
+
+        if (sample && i % SAMPLE_INTERVAL == 0) {
+            const AllocatorStats stats = engine->stats();
+            result.peak_pool_bytes = std::max(result.peak_pool_bytes, stats.pool_bytes);
+            result.peak_allocated_bytes = std::max(result.peak_allocated_bytes, stats.allocated_bytes);
+            if (Engine::HAS_FRAGMENTATION && stats.allocated_bytes) {
+                result.internal_fragmentation += 1.0 - (double)requested / (double)stats.allocated_bytes;
+                result.external_fragmentation += stats.external_fragmentation;
+                ++samples;
+            }
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    result.mops = (double)replay.ops.size() / seconds / 1e6;
+    if (Engine::HAS_FRAGMENTATION) {
+        // The pools keep their own peak, which sampling may have missed.
+        const AllocatorStats stats = engine->stats();
+        result.peak_pool_bytes = std::max(result.peak_pool_bytes, stats.pool_bytes);
+        result.peak_allocated_bytes = std::max(result.peak_allocated_bytes, stats.peak_allocated_bytes);
+    }
+    if (samples) {
+        result.internal_fragmentation /= (double)samples;
+        result.external_fragmentation /= (double)samples;
+    }
+    for (void* ptr : slots) {
+        if (ptr) {
+            engine->deallocate(ptr);
+        }
+    }
+    delete engine;
+    return result;
+}
+
+template <typename Engine, typename MakeEngine>
+void report(const char* name, const Replay& replay, MakeEngine&& make_engine) {
+    double mops = 0.0;
+    for (int i = 0; i < THROUGHPUT_RUNS; ++i) {
+        mops = std::max(mops, run<Engine>(replay, make_engine, false).mops);
+    }
+    const Result measured = run<Engine>(replay, make_engine, true);
+    std::printf("  %-24s %8.1f Mops/s %10zu KB peak heap %10zu KB peak allocated", name, mops,
+                measured.peak_pool_bytes / 1024, measured.peak_allocated_bytes / 1024);
+    if (Engine::HAS_FRAGMENTATION) {
+        std::printf(" %6.1f%% internal %6.1f%% external", 100.0 * measured.internal_fragmentation,
+                    100.0 * measured.external_fragmentation);
+    } else {
+        std::printf(" %16s %16s", "", "");
+    }
+    std::printf(" %6zu failed\n", measured.failures);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+        return 2;
+    }
+    std::vector<TraceEvent> events;
+    if (!AllocationTrace::read(argv[1], events)) {
+        std::fprintf(stderr, "%s is not a readable allocation trace\n", argv[1]);
+        return 1;
+    }
+
+    const Replay replay = translate(events);
+    uint16_t threads = 0;
+    for (const TraceEvent& event : events) {
+        threads = std::max(threads, event.thread);
+    }
+    const double seconds = events.empty() ? 0.0 : (double)events.back().timestamp / 1e9;
+    std::printf("%zu events from %u threads over %.3f s, %zu KB requested at peak, %zu unmatched\n\n",
+                events.size(), (unsigned)threads, seconds, replay.peak_requested_bytes / 1024, replay.unmatched);
+
+    size_t buddy_pool_size = MIN_BUDDY_POOL_SIZE;
+    while (buddy_pool_size < 4 * replay.peak_requested_bytes) {
+        buddy_pool_size *= 2;
+    }
+
+    report<SystemMalloc>("malloc", replay, [] { return new SystemMalloc(); });
+    report<PoolEngine<Allocator>>("Allocator FirstFit", replay, [] {
+        return new PoolEngine<Allocator>(INITIAL_POOL_SIZE, FitPolicy::FirstFit, MAX_POOL_SIZE);
+    });
+    report<PoolEngine<Allocator>>("Allocator SegregatedFit", replay, [] {
+        return new PoolEngine<Allocator>(INITIAL_POOL_SIZE, FitPolicy::SegregatedFit, MAX_POOL_SIZE);
+    });
+    report<PoolEngine<Allocator>>("Allocator TLSF", replay, [] {
+        return new PoolEngine<Allocator>(INITIAL_POOL_SIZE, FitPolicy::TLSF, MAX_POOL_SIZE);
+    });
+    report<PoolEngine<Allocator>>("Allocator BestFit", replay, [] {
+        return new PoolEngine<Allocator>(INITIAL_POOL_SIZE, FitPolicy::BestFit, MAX_POOL_SIZE);
+    });
+    report<PoolEngine<BuddyAllocator>>("BuddyAllocator", replay, [buddy_pool_size] {
+        return new PoolEngine<BuddyAllocator>(buddy_pool_size);
+    });
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "buddy_allocator.h"
+#include "os_memory.h"
+
+#include <algorithm> // for std::max
+#include <iomanip>   // for std::setw
+#include <iostream>
+
+// --- BuddyAllocator Method Implementations ---
+
+BuddyAllocator::BuddyAllocator(size_t pool_size)
+    : m_reservation(nullptr), m_reserved_size(0), m_base(nullptr), m_pool_size(0), m_max_order(MIN_ORDER),
+      m_nonempty_orders(0), m_free_bytes(0), m_free_block_count(0), m_peak_allocated_bytes(0),
+      m_allocation_count(0), m_free_count(0) {
+    for (FreeBlock*& list : m_free_lists) {
+        list = nullptr;
+    }
+
+    const unsigned max_order = std::max(orderFor(pool_size), MIN_ORDER + 1);
+    if (max_order > 62) {
+        std::cerr << "Pool size is too large." << std::endl;
+        return;
+    }
+
+    // Reserve enough to place the pool at a multiple of its own size, so that
+    // every block is aligned to its size in absolute terms, not just relative
+    // to the start of the pool.
+    const size_t pool_bytes = size_t(1) << max_order;
+    const size_t alignment = std::max(pool_bytes, os_page_size());
+    m_reserved_size = pool_bytes + alignment;
+    m_reservation = os_reserve(m_reserved_size);
+    char* base = (char*)(((uintptr_t)m_reservation + alignment - 1) & ~(uintptr_t)(alignment - 1));
+    if (!m_reservation || !os_commit(base, os_round_to_pages(pool_bytes))) {
+        std::cerr << "Could not reserve the memory pool." << std::endl;
+        if (m_reservation) {
+            os_release(m_reservation, m_reserved_size);
+            m_reservation = nullptr;
+        }
+        return;
+    }
+
+    m_base = base;
+    m_max_order = max_order;
+    m_pool_size = pool_bytes;
+    const size_t nodes = size_t(1) << (m_max_order - MIN_ORDER);
+    m_split_bits.assign((nodes + 63) / 64, 0);
+    m_buddy_bits.assign((nodes + 63) / 64, 0);
+
+    // The entire pool starts as a single free block of the top order.
+    addToFreeList(0, m_max_order);
+}
+
+BuddyAllocator::~BuddyAllocator() {
+    if (m_reservation) {
+        os_release(m_reservation, m_reserved_size);
+    }
+}
+
+unsigned BuddyAllocator::orderFor(size_t size) {
+    if (size <= (size_t(1) << MIN_ORDER)) {
+        return MIN_ORDER;
+    }
+    return 64 - __builtin_clzll(size - 1);
+}
+
+unsigned BuddyAllocator::orderOf(size_t offset) const {
+    unsigned order = m_max_order;
+    while (order > MIN_ORDER && testBit(m_split_bits, nodeIndex(order, offset))) {
+        --order;
+    }
+    return order;
+}
+
+void BuddyAllocator::addToFreeList(size_t offset, unsigned order) {
+    FreeBlock* block = (FreeBlock*)(m_base + offset);
+    FreeBlock*& head = m_free_lists[order];
+    block->next = head;
+    block->prev = nullptr;
+    if (head) {
+        head->prev = block;
+    }
+    head = block;
+    m_nonempty_orders |= uint64_t(1) << order;
+
+    if (order < m_max_order) {
+        flipBit(m_buddy_bits, nodeIndex(order + 1, offset));
+    }
+    m_free_bytes += size_t(1) << order;
+    ++m_free_block_count;
+}
+
+void BuddyAllocator::removeFromFreeList(size_t offset, unsigned order) {
+    FreeBlock* block = (FreeBlock*)(m_base + offset);
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        m_free_lists[order] = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+    if (!m_free_lists[order]) {
+        m_nonempty_orders &= ~(uint64_t(1) << order);
+    }
+
+    if (order < m_max_order) {
+        flipBit(m_buddy_bits, nodeIndex(order + 1, offset));
+    }
+    m_free_bytes -= size_t(1) << order;
+    --m_free_block_count;
+}
+
+void* BuddyAllocator::allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    // Take a block from the smallest non-empty order that is large enough.
+    const unsigned order = orderFor(size);
+    const uint64_t candidates = order < 64 ? m_nonempty_orders & ~((uint64_t(1) << order) - 1) : 0;
+    if (!candidates) {
+        std::cerr << "Out of memory!" << std::endl;
+        return nullptr;
+    }
+    unsigned current = __builtin_ctzll(candidates);
+    const size_t offset = (char*)m_free_lists[current] - m_base;
+    removeFromFreeList(offset, current);
+
+    // --- Block Splitting ---
+    // Halve the block until it is the requested order, freeing the upper halves.
+    while (current > order) {
+        flipBit(m_split_bits, nodeIndex(current, offset));
+        --current;
+        addToFreeList(offset + (size_t(1) << current), current);
+    }
+
+    ++m_allocation_count;
+    m_peak_allocated_bytes = std::max(m_peak_allocated_bytes, m_pool_size - m_free_bytes);
+    return m_base + offset;
+}
+
+void* BuddyAllocator::aligned_allocate(size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        std::cerr << "Alignment must be a power of two." << std::endl;
+        return nullptr;
+    }
+    if (size == 0) {
+        return nullptr;
+    }
+    return allocate(std::max(size, alignment));
+}
+
+void BuddyAllocator::deallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    const size_t offset = (char*)ptr - m_base;
+    releaseBlock(offset, orderOf(offset));
+}
+
+void BuddyAllocator::deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    // The block is at least the order the size needs, so that node must not be
+    // split. It is usually exactly that order; only a block from
+    // aligned_allocate can be larger, and then its node is a few levels up.
+    const size_t offset = (char*)ptr - m_base;
+    unsigned order = orderFor(size);
+    if (order <= m_max_order && (order == MIN_ORDER || !testBit(m_split_bits, nodeIndex(order, offset)))) {
+        while (order < m_max_order && !testBit(m_split_bits, nodeIndex(order + 1, offset))) {
+            ++order;
+        }
+        // A pointer into the middle of a block fails here.
+        if ((offset & ((size_t(1) << order) - 1)) == 0) {
+            releaseBlock(offset, order);
+            return;
+        }
+    }
+    std::cerr << "Deallocation size does not match the block." << std::endl;
+}
+
+void BuddyAllocator::releaseBlock(size_t offset, unsigned order) {
+    ++m_free_count;
+
+    // --- Coalescing (Merging) Logic ---
+    // This block is not free, so if exactly one half of its parent is free,
+    // that half is the buddy and the two merge into the parent.
+    while (order < m_max_order && testBit(m_buddy_bits, nodeIndex(order + 1, offset))) {
+        const size_t buddy = offset ^ (size_t(1) << order);
+        removeFromFreeList(buddy, order);
+        offset &= ~(size_t(1) << order);
+        ++order;
+        flipBit(m_split_bits, nodeIndex(order, offset));
+    }
+    addToFreeList(offset, order);
+}
+
+size_t BuddyAllocator::usable_size(const void* ptr) const {
+    return size_t(1) << orderOf((const char*)ptr - m_base);
+}
+
+AllocatorStats BuddyAllocator::stats() const {
+    AllocatorStats stats;
+    stats.pool_bytes = m_pool_size;
+    stats.allocated_bytes = m_pool_size - m_free_bytes;
+    stats.free_bytes = m_free_bytes;
+    stats.peak_allocated_bytes = m_peak_allocated_bytes;
+    stats.allocation_count = m_allocation_count;
+    stats.free_count = m_free_count;
+    stats.free_block_count = m_free_block_count;
+    stats.largest_free_block = m_nonempty_orders ? size_t(1) << (63 - __builtin_clzll(m_nonempty_orders)) : 0;
+    stats.external_fragmentation =
+        m_free_bytes ? 1.0 - (double)stats.largest_free_block / (double)m_free_bytes : 0.0;
+    return stats;
+}
+
+void BuddyAllocator::print_free_list() const {
+    std::cout << "--- Free List Status ---" << std::endl;
+    if (m_nonempty_orders == 0) {
+        std::cout << "[EMPTY]" << std::endl;
+        return;
+    }
+
+    int i = 0;
+    for (unsigned order = MIN_ORDER; order <= m_max_order; ++order) {
+        FreeBlock* current = m_free_lists[order];
+        if (current) {
+            std::cout << "Order " << order << ":" << std::endl;
+        }
+        while (current) {
+            std::cout << "Block " << std::setw(2) << i++
+                      << ": Address = " << current
+                      << ", Size = " << std::setw(5) << (size_t(1) << order) << " bytes" << std::endl;
+            current = current->next;
+        }
+    }
+    std::cout << "------------------------" << std::endl << std::endl;
+}
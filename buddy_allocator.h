@@ -0,0 +1,125 @@
+#ifndef BUDDY_ALLOCATOR_H
+#define BUDDY_ALLOCATOR_H
+
+#include "allocator.h" // for AllocatorStats
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <vector>
+
+// =================================================================================
+// BuddyAllocator Class
+//
+// A binary buddy allocator, an alternative engine to Allocator for workloads
+// made of power-of-two sizes such as I/O buffers. Every block is a power of two
+// in size (2^order bytes) and starts at a multiple of its size, so a 4 KB block
+// is 4 KB aligned. A request is rounded up to the next order and served by
+// halving the smallest larger free block until it fits. Freeing merges a block
+// with its buddy, the other half of the block it was split from, for as long
+// as that buddy is free too.
+//
+// Blocks carry no header. Each order has its own free list, and a bitmap of
+// the non-empty orders finds the list to take from with a single bit scan. The
+// state of the block tree lives in two bitmaps with one bit per node: whether
+// the node is split, and for the two halves of a split node, the XOR of
+// whether each is free. A block's buddy is found by flipping one bit of its
+// offset, and whether the buddy is free by reading one bit, so allocating and
+// freeing take at most log2(pool size) steps and never scan a list.
+//
+// The interface matches Allocator's, so a BuddyAllocator can back an
+// AllocatorResource, ObjectPool or BumpArena. The pool does not grow, and like
+// Allocator it has no synchronization.
+// =================================================================================
+class BuddyAllocator {
+public:
+    // The smallest block holds the two free-list links and keeps every block
+    // aligned for any fundamental type.
+    static constexpr unsigned MIN_ORDER = 4;
+
+    // Constructor: Creates a pool of pool_size bytes, rounded up to a power of two.
+    explicit BuddyAllocator(size_t pool_size);
+
+    // Destructor: Releases the pool back to the OS.
+    ~BuddyAllocator();
+
+    BuddyAllocator(const BuddyAllocator&) = delete;
+    BuddyAllocator& operator=(const BuddyAllocator&) = delete;
+
+    // allocate: A block of the smallest order that holds 'size' bytes.
+    void* allocate(size_t size);
+
+    // aligned_allocate: Blocks are aligned to their size, so this is a block
+    // of at least 'alignment' bytes, which must be a power of two.
+    void* aligned_allocate(size_t size, size_t alignment);
+
+    // deallocate: Free a block, merging it with its buddy while that is free.
+    void deallocate(void* ptr);
+
+    // deallocate (sized): As on Allocator; the order comes from the size
+    // instead of a walk down the block tree, and is checked against it.
+    void deallocate(void* ptr, size_t size);
+
+    // usable_size: The size of the block at ptr.
+    size_t usable_size(const void* ptr) const;
+
+    // owns: True if ptr points into this allocator's pool.
+    bool owns(const void* ptr) const { return (const char*)ptr >= m_base && (const char*)ptr < m_base + m_pool_size; }
+
+    // print_free_list: Print the free blocks of each order.
+    void print_free_list() const;
+
+    // stats: Current usage counters, as on Allocator.
+    AllocatorStats stats() const;
+
+private:
+    // A free block is linked into its order's list through its own memory.
+    struct FreeBlock {
+        FreeBlock* next;
+        FreeBlock* prev;
+    };
+
+    void* m_reservation;
+    size_t m_reserved_size;
+    char* m_base;          // Aligned to the pool size.
+    size_t m_pool_size;    // 2^m_max_order bytes.
+    unsigned m_max_order;
+
+    FreeBlock* m_free_lists[64];  // Indexed by order.
+    uint64_t m_nonempty_orders;   // Bit k is set while order k's list is non-empty.
+
+    // The block tree as an implicit binary heap: the node for the block of a
+    // given order at a given offset has index nodeIndex(order, offset). Only
+    // orders above MIN_ORDER have nodes, since smaller blocks never exist.
+    std::vector<uint64_t> m_split_bits;  // The node has been split into two halves.
+    std::vector<uint64_t> m_buddy_bits;  // Exactly one of the node's halves is free.
+
+    // Usage counters for stats().
+    size_t m_free_bytes;
+    size_t m_free_block_count;
+    size_t m_peak_allocated_bytes;
+    size_t m_allocation_count;
+    size_t m_free_count;
+
+    // orderFor: The smallest order whose blocks hold 'size' bytes.
+    static unsigned orderFor(size_t size);
+
+    size_t nodeIndex(unsigned order, size_t offset) const {
+        return ((size_t(1) << (m_max_order - order)) - 1) + (offset >> order);
+    }
+    static bool testBit(const std::vector<uint64_t>& bits, size_t index) { return (bits[index / 64] >> (index % 64)) & 1; }
+    static void flipBit(std::vector<uint64_t>& bits, size_t index) { bits[index / 64] ^= uint64_t(1) << (index % 64); }
+
+    // orderOf: The order of the allocated block at 'offset', found by walking
+    // down from the root to the first node that is not split.
+    unsigned orderOf(size_t offset) const;
+
+    // addToFreeList / removeFromFreeList: Keep the lists, the non-empty orders
+    // and the buddy bits in step.
+    void addToFreeList(size_t offset, unsigned order);
+    void removeFromFreeList(size_t offset, unsigned order);
+
+    // releaseBlock: Free the block at 'offset', merging it upwards.
+    void releaseBlock(size_t offset, unsigned order);
+};
+
+#endif // BUDDY_ALLOCATOR_H
@@ -0,0 +1,143 @@
+#ifndef BUMP_ARENA_H
+#define BUMP_ARENA_H
+
+#include "allocator.h"
+
+#include <algorithm> // for std::max
+#include <cstddef>   // for size_t, std::max_align_t
+#include <cstdint>   // for uintptr_t, SIZE_MAX
+#include <new>       // for placement new
+#include <utility>   // for std::forward
+
+// =================================================================================
+// BumpArena Class
+//
+// A monotonic allocator for objects that all die together, such as the
+// temporaries of one request. It takes large chunks from an Allocator and hands
+// out memory by bumping a pointer through the current chunk; there is no way
+// to free a single allocation. When a chunk runs out, the arena moves on to the
+// next one, chaining a new chunk from the pool if it has none left.
+//
+// checkpoint() records the current position and rollback() returns to it,
+// dropping everything allocated since; checkpoints nest like a stack. reset()
+// drops everything. Both are O(1): chunks are kept for reuse rather than given
+// back, until release() or the destructor returns them to the pool.
+//
+// Destructors of objects made with create() are never run. The arena has no
+// synchronization of its own; Pool may be ConcurrentAllocator or ThreadArenas,
+// but each BumpArena must still be used by one thread at a time.
+// =================================================================================
+template <typename Pool = Allocator>
+class BumpArena {
+public:
+    // A position in the arena to roll back to.
+    struct Checkpoint {
+        void* chunk;
+        char* cursor;
+    };
+
+    // Constructor: Chunks of at least chunk_size bytes come from 'pool', which
+    // must outlive the arena. No memory is taken until the first allocation.
+    explicit BumpArena(Pool& pool, size_t chunk_size = 64 * 1024)
+        : m_pool(pool), m_chunk_size(std::max<size_t>(chunk_size, BLOCK_GRANULE)), m_first(nullptr),
+          m_current(nullptr), m_cursor(nullptr), m_end(nullptr) {}
+
+    // Destructor: Returns every chunk to the pool.
+    ~BumpArena() { release(); }
+
+    BumpArena(const BumpArena&) = delete;
+    BumpArena& operator=(const BumpArena&) = delete;
+
+    // allocate: 'size' bytes aligned to 'alignment', which must be a power of
+    // two. Returns nullptr if the pool is out of memory. As with Allocator, a
+    // zero-byte request may return nullptr.
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        const uintptr_t start = ((uintptr_t)m_cursor + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (start > (uintptr_t)m_end || size > (uintptr_t)m_end - start) {
+            return allocateFromNextChunk(size, alignment);
+        }
+        m_cursor = (char*)(start + size);
+        return (void*)start;
+    }
+
+    // create: Allocate and construct a T from args.
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* storage = allocate(sizeof(T), alignof(T));
+        return storage ? new (storage) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    // checkpoint / rollback: Remember the current position, and later drop
+    // everything allocated after it. Rolling back also invalidates any
+    // checkpoint taken after this one.
+    Checkpoint checkpoint() const { return {m_current, m_cursor}; }
+    void rollback(const Checkpoint& checkpoint) {
+        m_current = (Chunk*)checkpoint.chunk;
+        m_cursor = checkpoint.cursor;
+        m_end = m_current ? m_current->data() + m_current->size : nullptr;
+    }
+
+    // reset: Drop every allocation, keeping the chunks for reuse.
+    void reset() { rollback(Checkpoint{nullptr, nullptr}); }
+
+    // release: Drop every allocation and return all chunks to the pool.
+    void release() {
+        while (m_first) {
+            Chunk* next = m_first->next;
+            m_pool.deallocate(m_first, sizeof(Chunk) + m_first->size);
+            m_first = next;
+        }
+        reset();
+    }
+
+private:
+    // Chunks form a list in the order they are used, each header followed by
+    // its data. Headers are a granule long, so the data is granule aligned.
+    struct alignas(BLOCK_GRANULE) Chunk {
+        Chunk* next;
+        size_t size;  // Bytes of data.
+
+        char* data() { return (char*)(this + 1); }
+    };
+
+    Pool& m_pool;
+    const size_t m_chunk_size;
+    Chunk* m_first;
+    Chunk* m_current;  // The chunk being bumped through; nullptr before the first.
+    char* m_cursor;    // The next free byte in m_current.
+    char* m_end;       // The end of m_current's data.
+
+    // allocateFromNextChunk: Move on to the chunk after the current one, or
+    // chain in a new one from the pool if there is none or it is too small.
+    void* allocateFromNextChunk(size_t size, size_t alignment) {
+        if (size > SIZE_MAX / 2 - alignment) {
+            return nullptr;
+        }
+        // Chunk data is granule aligned, so only larger alignments need slack.
+        const size_t needed = size + (alignment > BLOCK_GRANULE ? alignment - BLOCK_GRANULE : 0);
+
+        Chunk* next = m_current ? m_current->next : m_first;
+        if (!next || next->size < needed) {
+            const size_t chunk_size = std::max(m_chunk_size, needed);
+            Chunk* chunk = (Chunk*)m_pool.allocate(sizeof(Chunk) + chunk_size);
+            if (!chunk) {
+                return nullptr;
+            }
+            chunk->size = chunk_size;
+            chunk->next = next;
+            if (m_current) {
+                m_current->next = chunk;
+            } else {
+                m_first = chunk;
+            }
+            next = chunk;
+        }
+
+        m_current = next;
+        m_cursor = next->data();
+        m_end = m_cursor + next->size;
+        return allocate(size, alignment);
+    }
+};
+
+#endif // BUMP_ARENA_H
@@ -0,0 +1,285 @@
+#include "concurrent_allocator.h"
+
+#include <algorithm> // for std::max, std::min, std::remove_if
+#include <atomic>
+
+namespace {
+
+std::atomic<uint64_t> g_next_allocator_id{1};
+
+// A cached block is linked through the first word of its payload.
+struct CachedBlock {
+    CachedBlock* next;
+};
+
+} // namespace
+
+struct ConcurrentAllocator::ThreadCache {
+    struct Bin {
+        CachedBlock* head = nullptr;
+        size_t count = 0;
+    };
+
+    std::mutex owner_lock;          // Guards owner.
+    ConcurrentAllocator* owner;     // nullptr once the allocator has been destroyed.
+    Bin bins[CACHE_CLASSES];        // Only ever touched by the cache's own thread.
+    size_t cached_bytes = 0;        // The size of every block in bins, headers included.
+
+    explicit ThreadCache(ConcurrentAllocator* allocator) : owner(allocator) {}
+};
+
+// =================================================================================
+// ThreadCacheSet: The caches of one thread, one per ConcurrentAllocator it has
+// used. When the thread exits, the cached blocks go back to the allocators that
+// still exist.
+// =================================================================================
+struct ThreadCacheSet {
+    struct Entry {
+        uint64_t allocator_id;
+        std::shared_ptr<ConcurrentAllocator::ThreadCache> cache;
+    };
+
+    std::vector<Entry> entries;
+
+    // The most recently used entry, so the common case needs no search.
+    uint64_t last_id = 0;
+    ConcurrentAllocator::ThreadCache* last_cache = nullptr;
+
+    ~ThreadCacheSet() {
+        for (Entry& entry : entries) {
+            std::lock_guard<std::mutex> guard(entry.cache->owner_lock);
+            if (entry.cache->owner) {
+                entry.cache->owner->releaseCache(entry.cache.get());
+            }
+        }
+    }
+};
+
+static thread_local ThreadCacheSet t_thread_caches;
+
+// --- ConcurrentAllocator Method Implementations ---
+
+ConcurrentAllocator::ConcurrentAllocator(size_t pool_size, FitPolicy policy, size_t max_pool_size)
+    : m_allocator(pool_size, policy, max_pool_size), m_id(g_next_allocator_id.fetch_add(1)),
+      m_cache_limit(std::min(CACHE_MAX_BYTES, std::max(pool_size, max_pool_size) / 16)) {}
+
+ConcurrentAllocator::~ConcurrentAllocator() {
+    std::vector<std::shared_ptr<ThreadCache>> caches;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        caches.swap(m_caches);
+    }
+
+    // Once owner is cleared no exiting thread will touch the pool again; taking
+    // owner_lock also waits for one that is flushing right now.
+    for (std::shared_ptr<ThreadCache>& cache : caches) {
+        std::lock_guard<std::mutex> guard(cache->owner_lock);
+        cache->owner = nullptr;
+    }
+}
+
+size_t ConcurrentAllocator::cacheClassFor(size_t size) {
+    if (size <= CACHE_MIN_USABLE) {
+        return 0;
+    }
+    return (size - CACHE_MIN_USABLE + CACHE_CLASS_STEP - 1) / CACHE_CLASS_STEP;
+}
+
+ConcurrentAllocator::ThreadCache* ConcurrentAllocator::threadCache() {
+    ThreadCacheSet& set = t_thread_caches;
+    if (set.last_id == m_id) {
+        return set.last_cache;
+    }
+
+    ThreadCache* cache = nullptr;
+    for (ThreadCacheSet::Entry& entry : set.entries) {
+        if (entry.allocator_id == m_id) {
+            cache = entry.cache.get();
+            break;
+        }
+    }
+
+    if (!cache) {
+        // First use on this thread. Drop the caches of allocators that have been
+        // destroyed in the meantime, then register a new one.
+        set.entries.erase(std::remove_if(set.entries.begin(), set.entries.end(),
+                                         [](ThreadCacheSet::Entry& entry) {
+                                             std::lock_guard<std::mutex> guard(entry.cache->owner_lock);
+                                             return entry.cache->owner == nullptr;
+                                         }),
+                          set.entries.end());
+
+        std::shared_ptr<ThreadCache> new_cache = std::make_shared<ThreadCache>(this);
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_caches.push_back(new_cache);
+        }
+        set.entries.push_back({m_id, new_cache});
+        cache = new_cache.get();
+    }
+
+    set.last_id = m_id;
+    set.last_cache = cache;
+    return cache;
+}
+
+void ConcurrentAllocator::flushCache(ThreadCache* cache) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    for (size_t cache_class = 0; cache_class < CACHE_CLASSES; ++cache_class) {
+        releaseCached(cache, cache_class, cache->bins[cache_class].count);
+    }
+}
+
+void ConcurrentAllocator::releaseCached(ThreadCache* cache, size_t cache_class, size_t count) {
+    ThreadCache::Bin& bin = cache->bins[cache_class];
+    for (; count > 0 && bin.head; --count) {
+        CachedBlock* block = bin.head;
+        bin.head = block->next;
+        --bin.count;
+        cache->cached_bytes -= classBlockSize(cache_class);
+        m_allocator.deallocate(block);
+    }
+}
+
+void ConcurrentAllocator::releaseCache(ThreadCache* cache) {
+    flushCache(cache);
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_caches.erase(std::remove_if(m_caches.begin(), m_caches.end(),
+                                  [cache](const std::shared_ptr<ThreadCache>& entry) { return entry.get() == cache; }),
+                   m_caches.end());
+}
+
+void* ConcurrentAllocator::allocate(size_t size) {
+    const size_t cache_class = cacheClassFor(size);
+    if (size == 0 || cache_class >= CACHE_CLASSES) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        return m_allocator.allocate(size);
+    }
+
+    // --- Fast Path ---
+    // Pop a block of the right class from this thread's cache.
+    ThreadCache* cache = threadCache();
+    ThreadCache::Bin& bin = cache->bins[cache_class];
+    if (bin.head) {
+        CachedBlock* block = bin.head;
+        bin.head = block->next;
+        --bin.count;
+        cache->cached_bytes -= classBlockSize(cache_class);
+        return block;
+    }
+
+    // --- Cache Miss ---
+    // Take a batch of blocks of exactly the class size while we hold the lock.
+    const size_t class_size = CACHE_MIN_USABLE + cache_class * CACHE_CLASS_STEP;
+    std::lock_guard<std::mutex> guard(m_lock);
+    void* result = m_allocator.try_allocate(class_size);
+    if (!result) {
+        // The pool is full, but some of it may be sitting in this thread's
+        // cache in other classes. Hand it all back and try once more.
+        for (size_t other = 0; other < CACHE_CLASSES; ++other) {
+            releaseCached(cache, other, cache->bins[other].count);
+        }
+        return m_allocator.allocate(class_size);
+    }
+    for (size_t i = 1; i < CACHE_BATCH && cache->cached_bytes + classBlockSize(cache_class) <= m_cache_limit; ++i) {
+        CachedBlock* block = (CachedBlock*)m_allocator.try_allocate(class_size);
+        if (!block) {
+            break;
+        }
+        block->next = bin.head;
+        bin.head = block;
+        ++bin.count;
+        cache->cached_bytes += classBlockSize(cache_class);
+    }
+    return result;
+}
+
+void* ConcurrentAllocator::aligned_allocate(size_t size, size_t alignment) {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_allocator.aligned_allocate(size, alignment);
+}
+
+void ConcurrentAllocator::deallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    // The size of an allocated block only changes when its owner frees it, so
+    // it can be read without the lock.
+    const size_t cache_class = (m_allocator.usable_size(ptr) - CACHE_MIN_USABLE) / CACHE_CLASS_STEP;
+    if (cache_class >= CACHE_CLASSES) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_allocator.deallocate(ptr);
+        return;
+    }
+    cacheBlock(cache_class, ptr);
+}
+
+void ConcurrentAllocator::deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    // A block is never smaller than its request needed, so it can serve any
+    // request of the class that size maps to, even if it is a little larger.
+    const size_t cache_class = cacheClassFor(size);
+    if (cache_class >= CACHE_CLASSES) {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_allocator.deallocate(ptr, size);
+        return;
+    }
+    cacheBlock(cache_class, ptr);
+}
+
+void ConcurrentAllocator::cacheBlock(size_t cache_class, void* ptr) {
+    // --- Fast Path ---
+    ThreadCache* cache = threadCache();
+    ThreadCache::Bin& bin = cache->bins[cache_class];
+    CachedBlock* block = (CachedBlock*)ptr;
+    block->next = bin.head;
+    bin.head = block;
+    ++bin.count;
+    cache->cached_bytes += classBlockSize(cache_class);
+    if (bin.count <= CACHE_CAPACITY && cache->cached_bytes <= m_cache_limit) {
+        return;
+    }
+
+    // --- Cache Overflow ---
+    // Hand a batch back to the pool so it can be coalesced again, then, if the
+    // cache is still over its byte limit, the largest blocks from other classes.
+    std::lock_guard<std::mutex> guard(m_lock);
+    releaseCached(cache, cache_class, std::max<size_t>(bin.count / 2, 1));
+    for (size_t other = CACHE_CLASSES; other-- > 0 && cache->cached_bytes > m_cache_limit;) {
+        while (cache->bins[other].head && cache->cached_bytes > m_cache_limit) {
+            releaseCached(cache, other, 1);
+        }
+    }
+}
+
+void* ConcurrentAllocator::reallocate(void* ptr, size_t new_size) {
+    if (ptr == nullptr) {
+        return allocate(new_size);
+    }
+    if (new_size == 0) {
+        deallocate(ptr);
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_allocator.reallocate(ptr, new_size);
+}
+
+void ConcurrentAllocator::flush_thread_cache() {
+    flushCache(threadCache());
+}
+
+void ConcurrentAllocator::print_free_list() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_allocator.print_free_list();
+}
+
+AllocatorStats ConcurrentAllocator::stats() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_allocator.stats();
+}
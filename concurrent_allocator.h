@@ -0,0 +1,124 @@
+#ifndef CONCURRENT_ALLOCATOR_H
+#define CONCURRENT_ALLOCATOR_H
+
+#include "allocator.h"
+
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <memory>  // for std::shared_ptr
+#include <mutex>
+#include <vector>
+
+// =================================================================================
+// ConcurrentAllocator Class
+//
+// A thread-safe front end for an Allocator. The Allocator itself has no
+// synchronization, so its pool is shared under a single lock, but each thread
+// also keeps a small cache of recently freed blocks per size class (in the style
+// of glibc's tcache). Small allocations and frees are served from that cache
+// without touching the lock; only a cache miss or a full cache goes to the
+// shared pool, and then a whole batch of blocks moves at once.
+//
+// Blocks sitting in a thread cache look allocated to the shared pool, so they
+// are not coalesced until they are handed back: when the cache overflows, when
+// flush_thread_cache() is called, or when the thread exits. To bound how much
+// of the pool the caches can strand, each holds at most CACHE_MAX_BYTES (and
+// at most a sixteenth of the pool), and a thread that finds the pool full
+// hands back its own cache and tries again before giving up.
+// =================================================================================
+class ConcurrentAllocator {
+public:
+    // Constructor: Creates the shared pool; see Allocator for the arguments.
+    ConcurrentAllocator(size_t pool_size, FitPolicy policy = FitPolicy::FirstFit, size_t max_pool_size = 0);
+
+    // Destructor: Detaches every thread's cache and releases the pool.
+    ~ConcurrentAllocator();
+
+    ConcurrentAllocator(const ConcurrentAllocator&) = delete;
+    ConcurrentAllocator& operator=(const ConcurrentAllocator&) = delete;
+
+    // allocate / aligned_allocate / deallocate: As on Allocator, but safe to call
+    // from any number of threads. Aligned requests bypass the thread caches.
+    void* allocate(size_t size);
+    void* aligned_allocate(size_t size, size_t alignment);
+    void deallocate(void* ptr);
+
+    // deallocate (sized): Picks the cache class from the caller's size instead
+    // of the block header, so freeing a small block touches no memory outside
+    // this thread's cache. The size must be the one the block was allocated or
+    // last reallocated with; unlike on Allocator, it is not checked.
+    void deallocate(void* ptr, size_t size);
+
+    // reallocate: As on Allocator. Always goes to the shared pool, since a block
+    // can only be resized in place there.
+    void* reallocate(void* ptr, size_t new_size);
+
+    // flush_thread_cache: Return the calling thread's cached blocks to the pool.
+    void flush_thread_cache();
+
+    // print_free_list: Print the shared pool's free list.
+    void print_free_list() const;
+
+    // stats: The shared pool's usage counters. Blocks held in thread caches
+    // count as allocated.
+    AllocatorStats stats() const;
+
+    // Cached block sizes: class c holds blocks with CACHE_MIN_USABLE + c * CACHE_CLASS_STEP
+    // usable bytes, which are exactly the block sizes the pool hands out.
+    static constexpr size_t CACHE_CLASS_STEP = BLOCK_GRANULE;
+    static constexpr size_t CACHE_MIN_USABLE = MIN_BLOCK_SIZE - sizeof(BlockHeader);
+    static constexpr size_t CACHE_CLASSES = 32;
+
+    // The most blocks a thread keeps per class, and how many move to or from
+    // the pool at once.
+    static constexpr size_t CACHE_CAPACITY = 32;
+    static constexpr size_t CACHE_BATCH = CACHE_CAPACITY / 2;
+
+    // The most bytes of blocks a thread keeps across all its classes.
+    static constexpr size_t CACHE_MAX_BYTES = 64 * 1024;
+
+private:
+    struct ThreadCache;
+    friend struct ThreadCacheSet;
+
+    Allocator m_allocator;
+    mutable std::mutex m_lock;  // Guards m_allocator and m_caches.
+
+    // Every thread cache created for this allocator, so they can be detached
+    // when it is destroyed.
+    std::vector<std::shared_ptr<ThreadCache>> m_caches;
+
+    // Never reused, so a thread can't mistake a new allocator at the same
+    // address for an old one it still has a cache for.
+    const uint64_t m_id;
+
+    // The most bytes one thread's cache may hold for this allocator.
+    const size_t m_cache_limit;
+
+    // threadCache: The calling thread's cache for this allocator, created on first use.
+    ThreadCache* threadCache();
+
+    // flushCache: Return every block in the cache to the pool. Takes m_lock.
+    void flushCache(ThreadCache* cache);
+
+    // releaseCached: Return up to 'count' blocks of cache_class to the pool.
+    // The caller holds m_lock.
+    void releaseCached(ThreadCache* cache, size_t cache_class, size_t count);
+
+    // releaseCache: Flush a cache whose thread is exiting and forget it.
+    void releaseCache(ThreadCache* cache);
+
+    // cacheBlock: Put a freed block in this thread's cache for cache_class,
+    // handing a batch back to the pool if the cache is full.
+    void cacheBlock(size_t cache_class, void* ptr);
+
+    // cacheClassFor: The smallest class whose blocks can hold 'size' bytes.
+    static size_t cacheClassFor(size_t size);
+
+    // classBlockSize: The size of a class's blocks, header included.
+    static constexpr size_t classBlockSize(size_t cache_class) {
+        return MIN_BLOCK_SIZE + cache_class * CACHE_CLASS_STEP;
+    }
+};
+
+#endif // CONCURRENT_ALLOCATOR_H
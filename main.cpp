@@ -1,275 +1,472 @@
-#include <iostream>
-#include <cstddef> // for size_t
-#include <vector>
-#include <numeric> // for std::accumulate
-#include <iomanip> // for std::setw
-
-// =================================================================================
-// BlockHeader: Metadata for each memory block
-//
-// This struct is the core of our memory management. It's placed at the beginning
-// of every memory block (both allocated and free). The clever part is that the
-// linked list pointers for the free list are stored within the free blocks
-// themselves, so we don't waste extra space.
-// =================================================================================
-struct BlockHeader {
-    size_t size;      // The size of this block (including the header).
-    bool is_free;     // True if the block is free, false if allocated.
-    BlockHeader* next;  // Pointer to the next block in the *free list*.
-    BlockHeader* prev;  // Pointer to the previous block in the *free list*.
-};
-
-// =================================================================================
-// Allocator Class
-//
-// This class encapsulates all the logic for memory management. It requests a large
-// chunk of memory from the OS upon creation and then manages it internally.
-// =================================================================================
-class Allocator {
-public:
-    // Constructor: Initializes the memory pool.
-    Allocator(size_t pool_size) : m_pool_size(pool_size) {
-        if (pool_size < sizeof(BlockHeader)) {
-            m_memory_pool = nullptr;
-            m_free_list_head = nullptr;
-            std::cerr << "Pool size is too small." << std::endl;
-            return;
-        }
-
-        // Allocate the memory pool from the OS.
-        m_memory_pool = new char[pool_size];
-
-        // The entire pool starts as a single, large free block.
-        m_free_list_head = static_cast<BlockHeader*>(m_memory_pool);
-        m_free_list_head->size = pool_size;
-        m_free_list_head->is_free = true;
-        m_free_list_head->next = nullptr;
-        m_free_list_head->prev = nullptr;
-    }
-
-    // Destructor: Releases the memory pool back to the OS.
-    ~Allocator() {
-        delete[] static_cast<char*>(m_memory_pool);
-    }
-
-    // allocate: The custom 'malloc' implementation.
-    void* allocate(size_t size);
-
-    // deallocate: The custom 'free' implementation.
-    void deallocate(void* ptr);
-
-    // print_free_list: A utility to visualize the state of our free list.
-    void print_free_list() const;
-
-private:
-    void* m_memory_pool;
-    size_t m_pool_size;
-    BlockHeader* m_free_list_head;
-
-    // removeFromFreeList: Helper to remove a block from the doubly linked free list.
-    void removeFromFreeList(BlockHeader* block);
-
-    // addToFreeList: Helper to add a block to the front of the free list.
-    void addToFreeList(BlockHeader* block);
-};
-
-// --- Allocator Method Implementations ---
-
-void Allocator::removeFromFreeList(BlockHeader* block) {
-    if (block->prev) {
-        block->prev->next = block->next;
-    } else {
-        // This block was the head of the list.
-        m_free_list_head = block->next;
-    }
-    if (block->next) {
-        block->next->prev = block->prev;
-    }
-}
-
-void Allocator::addToFreeList(BlockHeader* block) {
-    block->is_free = true;
-    block->next = m_free_list_head;
-    block->prev = nullptr;
-    if (m_free_list_head) {
-        m_free_list_head->prev = block;
-    }
-    m_free_list_head = block;
-}
-
-void* Allocator::allocate(size_t size) {
-    if (size == 0) {
-        return nullptr;
-    }
-
-    // Calculate the total size needed, including the header.
-    const size_t total_size_needed = size + sizeof(BlockHeader);
-    BlockHeader* current = m_free_list_head;
-
-    // --- First-Fit Search ---
-    // Traverse the free list to find a suitable block.
-    while (current) {
-        if (current->size >= total_size_needed) {
-            // Found a suitable block.
-            
-            // --- Block Splitting ---
-            // If the block is large enough to be split, do so.
-            // The remaining part must be large enough to hold at least a header.
-            if (current->size > total_size_needed + sizeof(BlockHeader)) {
-                
-                // Create the new free block from the remainder.
-                BlockHeader* new_free_block = (BlockHeader*)((char*)current + total_size_needed);
-                new_free_block->size = current->size - total_size_needed;
-                new_free_block->is_free = true; // It's a free block.
-
-                // Update the original block to be the allocated size.
-                current->size = total_size_needed;
-                
-                // Replace the old large block with the new smaller free block in the list.
-                new_free_block->next = current->next;
-                new_free_block->prev = current->prev;
-                if (current->prev) {
-                    current->prev->next = new_free_block;
-                } else {
-                    m_free_list_head = new_free_block;
-                }
-                if (current->next) {
-                    current->next->prev = new_free_block;
-                }
-
-            } else {
-                // The block is a perfect fit or too small to split. Use the whole thing.
-                removeFromFreeList(current);
-            }
-
-            current->is_free = false;
-            // Return a pointer to the memory region *after* the header.
-            return (void*)((char*)current + sizeof(BlockHeader));
-        }
-        current = current->next;
-    }
-
-    // No suitable block found.
-    std::cerr << "Out of memory!" << std::endl;
-    return nullptr;
-}
-
-void Allocator::deallocate(void* ptr) {
-    if (ptr == nullptr) {
-        return;
-    }
-
-    // Get the header from the user's pointer.
-    BlockHeader* block_to_free = (BlockHeader*)((char*)ptr - sizeof(BlockHeader));
-    
-    // --- Coalescing (Merging) Logic ---
-    
-    // 1. Coalesce with the block physically to the right.
-    BlockHeader* next_physical_block = (BlockHeader*)((char*)block_to_free + block_to_free->size);
-    
-    // Check if the next block is within the pool bounds and is free.
-    if ((char*)next_physical_block < (char*)m_memory_pool + m_pool_size && next_physical_block->is_free) {
-        block_to_free->size += next_physical_block->size; // Merge sizes.
-        removeFromFreeList(next_physical_block); // Remove the merged block from the free list.
-    }
-
-    // 2. Coalesce with the block physically to the left.
-    // This is trickier. We iterate through the free list to find a block
-    // that ends exactly where our block_to_free begins.
-    BlockHeader* current_free = m_free_list_head;
-    while(current_free) {
-        if ((char*)current_free + current_free->size == (char*)block_to_free) {
-            current_free->size += block_to_free->size; // Merge sizes.
-            // The block to free is now part of the left block, so we just return.
-            // The left block is already in the free list, so no further action is needed.
-            return;
-        }
-        current_free = current_free->next;
-    }
-
-    // If no coalescing happened with the left block, add the current block to the free list.
-    addToFreeList(block_to_free);
-}
-
-void Allocator::print_free_list() const {
-    std::cout << "--- Free List Status ---" << std::endl;
-    BlockHeader* current = m_free_list_head;
-    if (!current) {
-        std::cout << "[EMPTY]" << std::endl;
-        return;
-    }
-
-    int i = 0;
-    while (current) {
-        std::cout << "Block " << std::setw(2) << i++
-                  << ": Address = " << current
-                  << ", Size = " << std::setw(5) << current->size << " bytes" << std::endl;
-        current = current->next;
-    }
-    std::cout << "------------------------" << std::endl << std::endl;
-}
-
-
-// =================================================================================
-// main: Test driver for the Allocator
-// =================================================================================
-int main() {
-    const size_t POOL_SIZE = 1024; // 1 KB pool
-    Allocator allocator(POOL_SIZE);
-
-    std::cout << "Initial state:" << std::endl;
-    allocator.print_free_list();
-
-    // --- Test 1: Simple Allocation & Block Splitting ---
-    std::cout << "--- Test 1: Allocating 100, 200, and 50 bytes ---" << std::endl;
-    void* p1 = allocator.allocate(100);
-    void* p2 = allocator.allocate(200);
-    void* p3 = allocator.allocate(50);
-
-    std::cout << "State after allocations:" << std::endl;
-    allocator.print_free_list();
-
-    // --- Test 2: Deallocation & Coalescing ---
-    std::cout << "--- Test 2: Freeing the middle block (p2) ---" << std::endl;
-    allocator.deallocate(p2);
-    p2 = nullptr;
-    std::cout << "State after freeing p2:" << std::endl;
-    allocator.print_free_list(); // Should have two free blocks now.
-
-    std::cout << "--- Freeing the first block (p1) ---" << std::endl;
-    allocator.deallocate(p1);
-    p1 = nullptr;
-    std::cout << "State after freeing p1 (should coalesce with p2's old space):" << std::endl;
-    allocator.print_free_list(); // The two free blocks should merge.
-
-    std::cout << "--- Freeing the last block (p3) ---" << std::endl;
-    allocator.deallocate(p3);
-    p3 = nullptr;
-    std::cout << "State after freeing p3 (should coalesce into one large block):" << std::endl;
-    allocator.print_free_list(); // Should be back to a single free block of 1024 bytes.
-
-    // --- Test 3: Stress Test ---
-    std::cout << "\n--- Test 3: Stress Test ---" << std::endl;
-    std::vector<void*> pointers;
-    for (int i = 0; i < 5; ++i) {
-        pointers.push_back(allocator.allocate(60));
-    }
-    allocator.print_free_list();
-
-    allocator.deallocate(pointers[1]);
-    allocator.deallocate(pointers[3]);
-    std::cout << "State after freeing pointers at index 1 and 3:" << std::endl;
-    allocator.print_free_list();
-
-    allocator.deallocate(pointers[2]);
-    std::cout << "State after freeing pointer at index 2 (should coalesce 1, 2, and 3):" << std::endl;
-    allocator.print_free_list();
-
-    // Clean up remaining allocations
-    allocator.deallocate(pointers[0]);
-    allocator.deallocate(pointers[4]);
-    std::cout << "Final state after all cleanup:" << std::endl;
-    allocator.print_free_list();
-
-    return 0;
-}
+#include "allocation_trace.h"
+#include "allocator.h"
+#include "buddy_allocator.h"
+#include "bump_arena.h"
+#include "concurrent_allocator.h"
+#include "object_pool.h"
+#include "persistent_heap.h"
+#include "pmr_resource.h"
+#include "shared_allocator.h"
+#include "thread_arenas.h"
+
+#include <algorithm> // for std::fill
+#include <cstring>   // for std::strcpy
+#include <iomanip>   // for std::setprecision
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// printStats: Show an allocator's usage counters.
+static void printStats(const AllocatorStats& stats) {
+    std::cout << "--- Allocator Stats ---" << std::endl
+              << "Pool:        " << stats.pool_bytes << " bytes" << std::endl
+              << "Allocated:   " << stats.allocated_bytes << " bytes (peak " << stats.peak_allocated_bytes << ")" << std::endl
+              << "Free:        " << stats.free_bytes << " bytes in " << stats.free_block_count << " blocks"
+              << " (largest " << stats.largest_free_block << ")" << std::endl
+              << "Operations:  " << stats.allocation_count << " allocations, " << stats.free_count << " frees" << std::endl
+              << "Fragmented:  " << std::fixed << std::setprecision(1) << 100.0 * stats.external_fragmentation
+              << "% of free memory is outside the largest block" << std::defaultfloat << std::endl
+              << "-----------------------" << std::endl << std::endl;
+}
+
+// =================================================================================
+// main: Test driver for the Allocator
+// =================================================================================
+int main() {
+    const size_t POOL_SIZE = 1024; // 1 KB pool
+    Allocator allocator(POOL_SIZE);
+
+    std::cout << "Initial state:" << std::endl;
+    allocator.print_free_list();
+
+    // --- Test 1: Simple Allocation & Block Splitting ---
+    std::cout << "--- Test 1: Allocating 100, 200, and 50 bytes ---" << std::endl;
+    void* p1 = allocator.allocate(100);
+    void* p2 = allocator.allocate(200);
+    void* p3 = allocator.allocate(50);
+
+    std::cout << "State after allocations:" << std::endl;
+    allocator.print_free_list();
+
+    // --- Test 2: Deallocation & Coalescing ---
+    std::cout << "--- Test 2: Freeing the middle block (p2) ---" << std::endl;
+    allocator.deallocate(p2);
+    p2 = nullptr;
+    std::cout << "State after freeing p2:" << std::endl;
+    allocator.print_free_list(); // Should have two free blocks now.
+
+    std::cout << "--- Freeing the first block (p1) ---" << std::endl;
+    allocator.deallocate(p1);
+    p1 = nullptr;
+    std::cout << "State after freeing p1 (should coalesce with p2's old space):" << std::endl;
+    allocator.print_free_list(); // The two free blocks should merge.
+
+    std::cout << "--- Freeing the last block (p3) ---" << std::endl;
+    allocator.deallocate(p3);
+    p3 = nullptr;
+    std::cout << "State after freeing p3 (should coalesce into one large block):" << std::endl;
+    allocator.print_free_list(); // Should be back to a single free block of 1024 bytes.
+
+    // --- Test 3: Stress Test ---
+    std::cout << "\n--- Test 3: Stress Test ---" << std::endl;
+    std::vector<void*> pointers;
+    for (int i = 0; i < 5; ++i) {
+        pointers.push_back(allocator.allocate(60));
+    }
+    allocator.print_free_list();
+
+    allocator.deallocate(pointers[1]);
+    allocator.deallocate(pointers[3]);
+    std::cout << "State after freeing pointers at index 1 and 3:" << std::endl;
+    allocator.print_free_list();
+    printStats(allocator.stats());
+
+    allocator.deallocate(pointers[2]);
+    std::cout << "State after freeing pointer at index 2 (should coalesce 1, 2, and 3):" << std::endl;
+    allocator.print_free_list();
+
+    // Clean up remaining allocations
+    allocator.deallocate(pointers[0]);
+    allocator.deallocate(pointers[4]);
+    std::cout << "Final state after all cleanup:" << std::endl;
+    allocator.print_free_list();
+
+    // --- Test 4: Segregated-Fit Size Classes ---
+    std::cout << "\n--- Test 4: Segregated-Fit Size Classes ---" << std::endl;
+    Allocator segregated(POOL_SIZE, FitPolicy::SegregatedFit);
+    void* s1 = segregated.allocate(40);
+    void* s2 = segregated.allocate(300);
+    void* s3 = segregated.allocate(100);
+    segregated.deallocate(s1);
+    std::cout << "State after freeing the 40-byte block (remainder and hole in different classes):" << std::endl;
+    segregated.print_free_list();
+
+    void* s4 = segregated.allocate(20);
+    std::cout << "State after allocating 20 bytes (served from the smallest non-empty class):" << std::endl;
+    segregated.print_free_list();
+
+    segregated.deallocate(s2);
+    segregated.deallocate(s4);
+    segregated.deallocate(s3);
+    std::cout << "State after freeing everything (should coalesce into one large block):" << std::endl;
+    segregated.print_free_list();
+
+    // --- Test 5: TLSF ---
+    std::cout << "\n--- Test 5: TLSF (Two-Level Segregated Fit) ---" << std::endl;
+    Allocator tlsf(POOL_SIZE, FitPolicy::TLSF);
+    std::vector<void*> tlsf_pointers;
+    for (size_t request : {24, 90, 200, 60, 120}) {
+        tlsf_pointers.push_back(tlsf.allocate(request));
+    }
+    tlsf.deallocate(tlsf_pointers[0]);
+    tlsf.deallocate(tlsf_pointers[2]);
+    std::cout << "State after freeing the 24- and 200-byte blocks:" << std::endl;
+    tlsf.print_free_list();
+
+    tlsf_pointers[0] = tlsf.allocate(150);
+    std::cout << "State after allocating 150 bytes (good fit from the 200-byte hole):" << std::endl;
+    tlsf.print_free_list();
+
+    for (size_t i : {0, 1, 3, 4}) {
+        tlsf.deallocate(tlsf_pointers[i]);
+    }
+    std::cout << "State after freeing everything (should coalesce into one large block):" << std::endl;
+    tlsf.print_free_list();
+
+    // --- Test 6: Aligned Allocation ---
+    std::cout << "\n--- Test 6: Aligned Allocation ---" << std::endl;
+    Allocator aligned(4 * POOL_SIZE);
+    void* a1 = aligned.allocate(10);
+    void* a2 = aligned.aligned_allocate(100, 64);
+    void* a3 = aligned.aligned_allocate(256, 1024);
+    std::cout << "allocate(10)                -> " << a1 << " (offset mod 16   = " << (uintptr_t)a1 % 16 << ")" << std::endl;
+    std::cout << "aligned_allocate(100, 64)   -> " << a2 << " (offset mod 64   = " << (uintptr_t)a2 % 64 << ")" << std::endl;
+    std::cout << "aligned_allocate(256, 1024) -> " << a3 << " (offset mod 1024 = " << (uintptr_t)a3 % 1024 << ")" << std::endl;
+    std::cout << "State after aligned allocations (padding returned to the free list):" << std::endl;
+    aligned.print_free_list();
+
+    aligned.deallocate(a2);
+    aligned.deallocate(a1);
+    aligned.deallocate(a3);
+    std::cout << "State after freeing everything (should coalesce into one large block):" << std::endl;
+    aligned.print_free_list();
+
+    // --- Test 7: Thread Caches ---
+    std::cout << "\n--- Test 7: ConcurrentAllocator with 4 threads ---" << std::endl;
+    // Room for every thread's cache at its byte limit plus the live blocks, so
+    // no thread can run out however the caches fill.
+    ConcurrentAllocator concurrent(4 * ConcurrentAllocator::CACHE_MAX_BYTES + 64 * POOL_SIZE);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&concurrent, t] {
+            std::vector<void*> live;
+            for (int i = 0; i < 10000; ++i) {
+                live.push_back(concurrent.allocate(16 + (i * 7 + t) % 200));
+                if (live.size() > 8) {
+                    concurrent.deallocate(live[i % live.size()]);
+                    live[i % live.size()] = live.back();
+                    live.pop_back();
+                }
+            }
+            for (void* p : live) {
+                concurrent.deallocate(p);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    std::cout << "State after the threads exit (their caches are flushed back to the pool):" << std::endl;
+    concurrent.print_free_list();
+
+    // --- Test 8: Per-Thread Arenas with Remote Frees ---
+    std::cout << "\n--- Test 8: ThreadArenas producer/consumer ---" << std::endl;
+    ThreadArenas arenas(2, 2 * POOL_SIZE);
+    std::vector<void*> messages;
+    std::thread producer([&arenas, &messages] {
+        for (int i = 0; i < 8; ++i) {
+            messages.push_back(arenas.allocate(100));
+        }
+    });
+    producer.join();
+    std::thread consumer([&arenas, &messages] {
+        void* own = arenas.allocate(32); // Binds the consumer to the second arena.
+        for (void* message : messages) {
+            arenas.deallocate(message);
+        }
+        arenas.deallocate(own);
+    });
+    consumer.join();
+    std::cout << "State after the consumer freed the producer's blocks (queued on arena 0):" << std::endl;
+    arenas.print_free_lists();
+
+    arenas.drain_remote_frees();
+    std::cout << "State after draining the remote frees:" << std::endl;
+    arenas.print_free_lists();
+
+    // --- Test 9: Pool Growth ---
+    std::cout << "\n--- Test 9: Growing a 1 KB pool inside a 1 MB reservation ---" << std::endl;
+    Allocator growable(POOL_SIZE, FitPolicy::FirstFit, 1024 * POOL_SIZE);
+    void* g1 = growable.allocate(600);
+    void* g2 = growable.allocate(3000); // Does not fit in the initial pool.
+    std::cout << "State after allocating 600 and 3000 bytes (the pool grew):" << std::endl;
+    growable.print_free_list();
+
+    growable.deallocate(g1);
+    growable.deallocate(g2);
+    std::cout << "State after freeing both (old and new space coalesce into one block):" << std::endl;
+    growable.print_free_list();
+
+    // --- Test 10: Purging Free Memory ---
+    std::cout << "\n--- Test 10: Returning free pages to the OS ---" << std::endl;
+    Allocator purgeable(1024 * POOL_SIZE);
+    void* big = purgeable.allocate(512 * POOL_SIZE);
+    std::fill((char*)big, (char*)big + 512 * POOL_SIZE, 1); // Touch every page.
+    purgeable.deallocate(big);
+    std::cout << "Bytes released by the first purge:  " << purgeable.purge() << std::endl;
+    std::cout << "Bytes released by a second purge:   " << purgeable.purge() << " (nothing new to release)" << std::endl;
+
+    // --- Test 11: Reallocation ---
+    std::cout << "\n--- Test 11: Growing and shrinking in place ---" << std::endl;
+    Allocator resizable(POOL_SIZE);
+    void* r1 = resizable.allocate(100);
+    void* r2 = resizable.allocate(100);
+    resizable.deallocate(r2);
+    void* grown = resizable.reallocate(r1, 400);
+    std::cout << "reallocate(100 -> 400) " << (grown == r1 ? "grew in place" : "moved") << std::endl;
+    void* shrunk = resizable.reallocate(grown, 50);
+    std::cout << "reallocate(400 -> 50)  " << (shrunk == grown ? "shrank in place" : "moved") << std::endl;
+    void* blocker = resizable.allocate(30); // Takes the space just freed by the shrink.
+    void* moved = resizable.reallocate(shrunk, 200);
+    std::cout << "reallocate(50 -> 200)  " << (moved == shrunk ? "grew in place" : "moved (right neighbour in use)") << std::endl;
+    resizable.deallocate(blocker);
+    resizable.deallocate(moved);
+    std::cout << "State after freeing everything (should coalesce into one large block):" << std::endl;
+    resizable.print_free_list();
+
+    // --- Test 12: std::pmr Containers ---
+    std::cout << "\n--- Test 12: std::pmr containers on the pool ---" << std::endl;
+    Allocator pmr_pool(4 * POOL_SIZE);
+    {
+        AllocatorResource<> resource(pmr_pool);
+        std::pmr::vector<std::pmr::string> words(&resource);
+        for (const char* word : {"blocks", "from", "the", "pool", "for", "every", "element", "and", "string"}) {
+            words.emplace_back(word);
+        }
+        words.back().append(" that is too long for the small-string buffer");
+        std::cout << "A pmr::vector of " << words.size() << " pmr::strings lives in the pool:" << std::endl;
+        pmr_pool.print_free_list();
+    }
+    std::cout << "State after the vector is destroyed (should coalesce into one large block):" << std::endl;
+    pmr_pool.print_free_list();
+
+    // --- Test 13: Object Pool ---
+    std::cout << "\n--- Test 13: ObjectPool of fixed-size structs ---" << std::endl;
+    struct Particle {
+        double x, y, z;
+        Particle(double px, double py, double pz) : x(px), y(py), z(pz) {}
+    };
+    Allocator slab_source(4 * POOL_SIZE);
+    {
+        ObjectPool<Particle> particles(slab_source, 16);
+        std::vector<Particle*> live;
+        for (int i = 0; i < 20; ++i) {
+            live.push_back(particles.create(i, 2.0 * i, 3.0 * i));
+        }
+        std::cout << "Particles 0 and 1 are " << (char*)live[1] - (char*)live[0]
+                  << " bytes apart (sizeof(Particle) = " << sizeof(Particle) << ", no header)" << std::endl;
+        particles.destroy(live[5]);
+        Particle* reused = particles.create(0.0, 0.0, 0.0);
+        std::cout << "A new particle " << (reused == live[5] ? "reuses" : "does not reuse")
+                  << " the slot just freed" << std::endl;
+        std::cout << "State with two slabs of 16 particles carved out of the pool:" << std::endl;
+        slab_source.print_free_list();
+    }
+    std::cout << "State after the ObjectPool is destroyed (should coalesce into one large block):" << std::endl;
+    slab_source.print_free_list();
+
+    // --- Test 14: Bump Arena ---
+    std::cout << "\n--- Test 14: BumpArena with checkpoints ---" << std::endl;
+    Allocator arena_source(4 * POOL_SIZE);
+    {
+        BumpArena<> request_arena(arena_source, 512);
+        for (int i = 0; i < 10; ++i) {
+            request_arena.allocate(40);
+        }
+        BumpArena<>::Checkpoint before_scratch = request_arena.checkpoint();
+        void* scratch = request_arena.allocate(1000); // Too big for the first chunk: chains a second one.
+        std::cout << "State after 10 small allocations and a 1000-byte one (two chunks):" << std::endl;
+        arena_source.print_free_list();
+
+        request_arena.rollback(before_scratch);
+        void* reused = request_arena.allocate(1000);
+        std::cout << "After rolling back, the next 1000-byte allocation " << (reused == scratch ? "reuses" : "does not reuse")
+                  << " the second chunk" << std::endl;
+        request_arena.reset(); // Everything is gone at once; the chunks stay for the next request.
+    }
+    std::cout << "State after the arena is destroyed (should coalesce into one large block):" << std::endl;
+    arena_source.print_free_list();
+
+    // --- Test 15: Buddy Allocator ---
+    std::cout << "\n--- Test 15: BuddyAllocator for power-of-two buffers ---" << std::endl;
+    BuddyAllocator buddy(4 * POOL_SIZE);
+    void* b1 = buddy.allocate(512);
+    void* b2 = buddy.allocate(1000); // Rounded up to 1024.
+    void* b3 = buddy.allocate(512);
+    std::cout << "allocate(1000) -> " << b2 << " (usable size " << buddy.usable_size(b2)
+              << ", offset mod 1024 = " << (uintptr_t)b2 % 1024 << ")" << std::endl;
+    std::cout << "State after allocating 512, 1000 and 512 bytes:" << std::endl;
+    buddy.print_free_list();
+
+    buddy.deallocate(b1);
+    buddy.deallocate(b3, 512);
+    buddy.deallocate(b2, 1000);
+    std::cout << "State after freeing everything (buddies merge back into one block):" << std::endl;
+    buddy.print_free_list();
+
+    // --- Test 16: Best Fit ---
+    std::cout << "\n--- Test 16: Best Fit (size-ordered tree) ---" << std::endl;
+    for (FitPolicy policy : {FitPolicy::FirstFit, FitPolicy::BestFit}) {
+        Allocator fitter(POOL_SIZE, policy);
+        void* large_hole = fitter.allocate(200);
+        void* f1 = fitter.allocate(40);
+        void* small_hole = fitter.allocate(100);
+        void* f2 = fitter.allocate(40);
+        fitter.deallocate(small_hole);
+        fitter.deallocate(large_hole); // FirstFit now finds this one first.
+        void* fitted = fitter.allocate(90);
+        std::cout << (policy == FitPolicy::BestFit ? "BestFit " : "FirstFit")
+                  << " puts 90 bytes in the " << (fitted == small_hole ? "100-byte hole" : "200-byte hole") << std::endl;
+        if (policy == FitPolicy::BestFit) {
+            std::cout << "State with the 200-byte hole left whole (blocks listed smallest first):" << std::endl;
+            fitter.print_free_list();
+        }
+        fitter.deallocate(fitted);
+        fitter.deallocate(f1);
+        fitter.deallocate(f2);
+    }
+
+    // --- Test 17: Shared Memory ---
+    std::cout << "\n--- Test 17: Handing a block to another process ---" << std::endl;
+    const std::string segment_name = "/allocator_demo_" + std::to_string(getpid());
+    SharedAllocator shared(segment_name.c_str(), POOL_SIZE);
+    int channel[2];
+    if (shared.is_attached() && pipe(channel) == 0) {
+        const pid_t child = fork();
+        if (child == 0) {
+            // The child inherits the mapping, writes a message into a block of
+            // the shared pool and sends its offset, not its address.
+            char* message = (char*)shared.allocate(64);
+            std::strcpy(message, "written by the child process");
+            const size_t offset = shared.offset_of(message);
+            ssize_t written = write(channel[1], &offset, sizeof(offset));
+            _exit(written == sizeof(offset) ? 0 : 1);
+        }
+        size_t offset = 0;
+        if (child > 0 && read(channel[0], &offset, sizeof(offset)) == sizeof(offset)) {
+            waitpid(child, nullptr, 0);
+            char* message = (char*)shared.pointer_at(offset);
+            std::cout << "Parent reads: \"" << message << "\"" << std::endl;
+            std::cout << "Pool before the parent frees it:" << std::endl;
+            printStats(shared.stats());
+            shared.deallocate(message);
+            shared.print_free_list();
+        }
+        close(channel[0]);
+        close(channel[1]);
+    }
+    SharedAllocator::remove(segment_name.c_str());
+
+    // --- Test 18: Persistent Heap ---
+    std::cout << "\n--- Test 18: A heap that survives a restart ---" << std::endl;
+    const std::string heap_path = "/tmp/allocator_demo_" + std::to_string(getpid()) + ".heap";
+    {
+        PersistentHeap heap(heap_path.c_str(), POOL_SIZE);
+        char* note = (char*)heap.allocate(64);
+        if (note) {
+            std::strcpy(note, "saved before a clean shutdown");
+            heap.set_root(0, note);
+        }
+    }
+    {
+        PersistentHeap heap(heap_path.c_str(), POOL_SIZE);
+        const char* note = (const char*)heap.root(0);
+        std::cout << "Reopened (restored: " << heap.was_restored() << ", recovered: " << heap.was_recovered()
+                  << "), root 0: \"" << (note ? note : "") << "\"" << std::endl;
+    }
+    // A child process adds a block and dies without closing the heap.
+    const pid_t crasher = fork();
+    if (crasher == 0) {
+        PersistentHeap heap(heap_path.c_str(), POOL_SIZE);
+        char* note = (char*)heap.allocate(64);
+        if (note) {
+            std::strcpy(note, "saved before a crash");
+            heap.set_root(1, note);
+        }
+        _exit(0);
+    }
+    if (crasher > 0) {
+        waitpid(crasher, nullptr, 0);
+        PersistentHeap heap(heap_path.c_str(), POOL_SIZE);
+        const char* first = (const char*)heap.root(0);
+        const char* second = (const char*)heap.root(1);
+        std::cout << "Reopened (restored: " << heap.was_restored() << ", recovered: " << heap.was_recovered()
+                  << "), root 0: \"" << (first ? first : "") << "\", root 1: \"" << (second ? second : "") << "\""
+                  << std::endl;
+        printStats(heap.stats());
+    }
+    unlink(heap_path.c_str());
+
+    // --- Test 19: Allocation Trace ---
+    std::cout << "\n--- Test 19: Recording calls for replay ---" << std::endl;
+    const std::string trace_path = "/tmp/allocator_demo_" + std::to_string(getpid()) + ".trace";
+    {
+        AllocationTrace trace(trace_path.c_str());
+        Allocator traced(POOL_SIZE);
+        traced.set_trace(&trace);
+        void* buffer = traced.allocate(100);
+        void* line = traced.aligned_allocate(64, 256);
+        buffer = traced.reallocate(buffer, 400);
+        traced.deallocate(line);
+        traced.deallocate(buffer);
+    }
+    std::vector<TraceEvent> events;
+    if (AllocationTrace::read(trace_path.c_str(), events)) {
+        const char* const op_names[] = {"", "allocate", "free", "reallocate"};
+        for (const TraceEvent& event : events) {
+            std::cout << "thread " << event.thread << ": " << op_names[event.op];
+            if (event.op != TraceEvent::Free) {
+                std::cout << " " << event.size << " bytes";
+            }
+            if (event.alignment_log2) {
+                std::cout << " aligned to " << (1u << event.alignment_log2);
+            }
+            if (event.op == TraceEvent::Reallocate) {
+                std::cout << (event.address == event.previous ? " in place" : " (moved)");
+            }
+            std::cout << std::endl;
+        }
+    }
+    unlink(trace_path.c_str());
+
+    // --- Test 20: Heap Walk ---
+    std::cout << "\n--- Test 20: Walking every block of the pool ---" << std::endl;
+    Allocator walked(POOL_SIZE);
+    void* w1 = walked.allocate(64);
+    void* w2 = walked.allocate(128);
+    void* w3 = walked.allocate(32);
+    walked.deallocate(w2);
+    walked.walk([](const HeapBlock& block) {
+        std::cout << "Offset " << block.offset << ": " << block.size << " bytes, "
+                  << (block.free ? "free" : "allocated") << std::endl;
+    });
+    walked.deallocate(w1);
+    walked.deallocate(w3);
+
+    return 0;
+}
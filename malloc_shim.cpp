@@ -0,0 +1,465 @@
+#include "allocator.h"
+#include "allocation_trace.h"
+#include "os_memory.h"
+
+#include <algorithm> // for std::min
+#include <atomic>
+#include <cerrno>
+#include <cstdio>    // for std::snprintf
+#include <cstdlib>   // for std::getenv
+#include <cstring>   // for std::memcpy, std::memset, std::strcmp
+#include <mutex>
+#include <new>
+
+#include <pthread.h>
+#include <unistd.h>
+
+// =================================================================================
+// malloc_shim: The Allocator as a drop-in replacement for the C and C++ heap
+//
+// Built as liballocator.so (make preload) and loaded with LD_PRELOAD, this
+// exports malloc, free, calloc, realloc, the aligned allocation functions,
+// malloc_usable_size and every global operator new and delete, so any
+// dynamically linked program runs on the Allocator without being rebuilt:
+//
+//     LD_PRELOAD=./liballocator.so ALLOCATOR_STATS=1 ./service
+//
+// A malloc replacement must never call malloc itself, which rules out the
+// containers and thread_local objects ConcurrentAllocator and ThreadArenas
+// rely on. Instead the shim keeps a fixed array of arenas, each an Allocator
+// under its own lock, built in static storage on the first call. Threads are
+// bound to arenas round-robin through a plain thread-local index, and a block
+// is freed in the arena whose pool holds it. Each pool reserves a large range
+// of address space and grows into it on demand.
+//
+// Environment variables, read once at startup:
+//   ALLOCATOR_ARENAS  Number of arenas (default: one per CPU, at most 16).
+//   ALLOCATOR_POLICY  first, segregated, tlsf (default) or best.
+//   ALLOCATOR_STATS   If set, print usage counters to stderr at exit.
+//   ALLOCATOR_TRACE   If set, record every call to the file named by its
+//                     value with ".<pid>" appended (see AllocationTrace).
+//
+// Everything except the exported functions is hidden, so the shim's classes
+// can't collide with a program's own symbols of the same name.
+// =================================================================================
+
+#define SHIM_EXPORT __attribute__((visibility("default")))
+
+namespace {
+
+const size_t MAX_ARENAS = 64;
+const size_t DEFAULT_MAX_ARENAS = 16;
+const size_t ARENA_INITIAL_SIZE = 4 * 1024 * 1024;
+
+// Address space each arena may grow into. Reserving it costs no memory. The
+// compact build's 32-bit offsets cap a pool below 4 GiB.
+const size_t ARENA_MAX_SIZE = COMPACT_LINKS ? size_t(3) << 30 : size_t(64) << 30;
+
+struct Arena {
+    std::mutex lock;
+    alignas(Allocator) unsigned char storage[sizeof(Allocator)];
+
+    Allocator& allocator() { return *(Allocator*)storage; }
+};
+
+Arena g_arenas[MAX_ARENAS];
+
+// Set once the arenas are built. free and realloc read it without taking the
+// initialisation once_flag, so it is published with release order.
+std::atomic<size_t> g_arena_count{0};
+std::atomic<size_t> g_next_arena{0};
+std::once_flag g_init_once;
+
+// The trace, if ALLOCATOR_TRACE is set, built in place like the arenas.
+alignas(AllocationTrace) unsigned char g_trace_storage[sizeof(AllocationTrace)];
+AllocationTrace* g_trace = nullptr;
+
+// Trivially constructed and destroyed, so touching it never allocates, and
+// initial-exec so it never needs a lazily allocated TLS block.
+__attribute__((tls_model("initial-exec"))) thread_local size_t t_arena = MAX_ARENAS;
+
+FitPolicy policyFromEnvironment() {
+    const char* name = std::getenv("ALLOCATOR_POLICY");
+    if (name && std::strcmp(name, "first") == 0) {
+        return FitPolicy::FirstFit;
+    }
+    if (name && std::strcmp(name, "segregated") == 0) {
+        return FitPolicy::SegregatedFit;
+    }
+    if (name && std::strcmp(name, "best") == 0) {
+        return FitPolicy::BestFit;
+    }
+    return FitPolicy::TLSF;
+}
+
+// forkPrepare / forkRelease: Hold every arena lock across fork, so the child
+// never inherits a lock taken by a thread that does not exist in it.
+void forkPrepare() {
+    for (size_t i = 0; i < g_arena_count; ++i) {
+        g_arenas[i].lock.lock();
+    }
+}
+
+void forkRelease() {
+    for (size_t i = g_arena_count; i-- > 0;) {
+        g_arenas[i].lock.unlock();
+    }
+}
+
+// forkChild: The child stops tracing: its calls would be mixed into the
+// parent's file, under the same addresses.
+void forkChild() {
+    for (size_t i = 0; i < g_arena_count; ++i) {
+        g_arenas[i].allocator().set_trace(nullptr);
+    }
+    g_trace = nullptr;
+    forkRelease();
+}
+
+void startTrace(const char* path) {
+    char file[4096];
+    const int length = std::snprintf(file, sizeof(file), "%s.%d", path, (int)getpid());
+    if (length <= 0 || (size_t)length >= sizeof(file)) {
+        return;
+    }
+    AllocationTrace* trace = new (g_trace_storage) AllocationTrace(file);
+    if (!trace->is_open()) {
+        return;
+    }
+    for (size_t i = 0; i < g_arena_count; ++i) {
+        g_arenas[i].allocator().set_trace(trace);
+    }
+    g_trace = trace;
+}
+
+void initialize() {
+    size_t count = std::min<size_t>((size_t)sysconf(_SC_NPROCESSORS_ONLN), DEFAULT_MAX_ARENAS);
+    if (const char* arenas = std::getenv("ALLOCATOR_ARENAS")) {
+        count = std::strtoul(arenas, nullptr, 10);
+    }
+    count = std::min(std::max<size_t>(count, 1), MAX_ARENAS);
+
+    const FitPolicy policy = policyFromEnvironment();
+    for (size_t i = 0; i < count; ++i) {
+        new (g_arenas[i].storage) Allocator(ARENA_INITIAL_SIZE, policy, ARENA_MAX_SIZE);
+    }
+    g_arena_count.store(count, std::memory_order_release);
+    if (const char* path = std::getenv("ALLOCATOR_TRACE")) {
+        startTrace(path);
+    }
+    pthread_atfork(forkPrepare, forkRelease, forkChild);
+}
+
+size_t threadArena() {
+    if (t_arena == MAX_ARENAS) {
+        std::call_once(g_init_once, initialize);
+        t_arena = g_next_arena.fetch_add(1, std::memory_order_relaxed) % g_arena_count;
+    }
+    return t_arena;
+}
+
+// arenaOf: The arena whose pool holds ptr, or nullptr for memory that did not
+// come from the shim. No arena lock is taken: owns() only reads the arena's
+// reservation, which is fixed once the arena is built, never the size of its
+// pool, which another thread may be growing.
+Arena* arenaOf(const void* ptr) {
+    const size_t count = g_arena_count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i) {
+        if (g_arenas[i].allocator().owns(ptr)) {
+            return &g_arenas[i];
+        }
+    }
+    return nullptr;
+}
+
+// allocateWith: Try the thread's own arena, then every other one. A request
+// no arena could ever hold fails at once rather than in every arena in turn.
+// allocate_fn must fail quietly: the shim reports running out only the way
+// malloc does, with nullptr and ENOMEM, never on the program's stderr.
+template <typename AllocateFn>
+void* allocateWith(size_t size, AllocateFn&& allocate_fn) {
+    if (size >= ARENA_MAX_SIZE) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    const size_t home = threadArena();
+    for (size_t i = 0; i < g_arena_count; ++i) {
+        Arena& arena = g_arenas[(home + i) % g_arena_count];
+        std::lock_guard<std::mutex> guard(arena.lock);
+        if (void* ptr = allocate_fn(arena.allocator())) {
+            return ptr;
+        }
+    }
+    errno = ENOMEM;
+    return nullptr;
+}
+
+void* shimAllocate(size_t size) {
+    // malloc(0) must return a pointer that can be freed; the Allocator returns
+    // nullptr for 0 bytes.
+    const size_t request = size ? size : 1;
+    return allocateWith(request, [request](Allocator& allocator) { return allocator.try_allocate(request); });
+}
+
+void* shimAlignedAllocate(size_t alignment, size_t size) {
+    const size_t request = size ? size : 1;
+    return allocateWith(std::max(request, alignment), [request, alignment](Allocator& allocator) {
+        return allocator.try_aligned_allocate(request, alignment);
+    });
+}
+
+void shimDeallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    // Memory handed out before the shim was loaded, e.g. by the dynamic
+    // loader, is left alone.
+    if (Arena* arena = arenaOf(ptr)) {
+        std::lock_guard<std::mutex> guard(arena->lock);
+        arena->allocator().deallocate(ptr);
+    }
+}
+
+void shimDeallocateSized(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (Arena* arena = arenaOf(ptr)) {
+        std::lock_guard<std::mutex> guard(arena->lock);
+        arena->allocator().deallocate(ptr, size ? size : 1);
+    }
+}
+
+bool isValidAlignment(size_t alignment) {
+    return alignment != 0 && (alignment & (alignment - 1)) == 0;
+}
+
+// newWith: operator new's contract: retry through the new-handler until the
+// allocation succeeds, and throw bad_alloc if there is none.
+template <typename AllocateFn>
+void* newWith(AllocateFn&& allocate_fn) {
+    for (;;) {
+        if (void* ptr = allocate_fn()) {
+            return ptr;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+// flushTraceAtExit: Calls made after this, by later exit handlers, stay in
+// the ring and are lost.
+__attribute__((destructor)) void flushTraceAtExit() {
+    if (g_trace) {
+        g_trace->flush();
+    }
+}
+
+__attribute__((destructor)) void printStatsAtExit() {
+    if (!std::getenv("ALLOCATOR_STATS") || g_arena_count == 0) {
+        return;
+    }
+    AllocatorStats total = {};
+    for (size_t i = 0; i < g_arena_count; ++i) {
+        std::lock_guard<std::mutex> guard(g_arenas[i].lock);
+        const AllocatorStats stats = g_arenas[i].allocator().stats();
+        total.pool_bytes += stats.pool_bytes;
+        total.allocated_bytes += stats.allocated_bytes;
+        total.peak_allocated_bytes += stats.peak_allocated_bytes;
+        total.allocation_count += stats.allocation_count;
+        total.free_count += stats.free_count;
+        total.free_block_count += stats.free_block_count;
+    }
+    // Formatted on the stack and written directly: stdio may allocate.
+    char line[256];
+    const int length = std::snprintf(line, sizeof(line),
+                                     "liballocator: %zu arenas, pool %zu bytes, allocated %zu bytes (peak %zu), "
+                                     "%zu allocations, %zu frees, %zu free blocks\n",
+                                     g_arena_count.load(), total.pool_bytes, total.allocated_bytes,
+                                     total.peak_allocated_bytes, total.allocation_count, total.free_count,
+                                     total.free_block_count);
+    if (length > 0) {
+        ssize_t written = write(STDERR_FILENO, line, std::min<size_t>((size_t)length, sizeof(line) - 1));
+        (void)written;
+    }
+}
+
+} // namespace
+
+// --- C Allocation Functions ---
+
+extern "C" {
+
+SHIM_EXPORT void* malloc(size_t size) {
+    return shimAllocate(size);
+}
+
+SHIM_EXPORT void free(void* ptr) {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void* calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    // Freed blocks are reused as they are, so the memory has to be cleared.
+    void* ptr = shimAllocate(count * size);
+    if (ptr) {
+        std::memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+SHIM_EXPORT void* realloc(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+        return shimAllocate(size);
+    }
+    if (size == 0) {
+        shimDeallocate(ptr);
+        return nullptr;
+    }
+    Arena* arena = arenaOf(ptr);
+    if (!arena) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> guard(arena->lock);
+        if (void* resized = arena->allocator().try_reallocate(ptr, size)) {
+            return resized;
+        }
+    }
+
+    // The block's arena is exhausted; move it to whichever arena has room.
+    void* moved = shimAllocate(size);
+    if (moved) {
+        std::memcpy(moved, ptr, std::min(size, arena->allocator().usable_size(ptr)));
+        shimDeallocate(ptr);
+    }
+    return moved;
+}
+
+SHIM_EXPORT int posix_memalign(void** result, size_t alignment, size_t size) {
+    if (!isValidAlignment(alignment) || alignment % sizeof(void*) != 0) {
+        return EINVAL;
+    }
+    void* ptr = shimAlignedAllocate(alignment, size);
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *result = ptr;
+    return 0;
+}
+
+SHIM_EXPORT void* aligned_alloc(size_t alignment, size_t size) {
+    if (!isValidAlignment(alignment)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    return shimAlignedAllocate(alignment, size);
+}
+
+SHIM_EXPORT void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+SHIM_EXPORT void* valloc(size_t size) {
+    return shimAlignedAllocate(os_page_size(), size);
+}
+
+SHIM_EXPORT void* pvalloc(size_t size) {
+    return shimAlignedAllocate(os_page_size(), os_round_to_pages(size ? size : 1));
+}
+
+SHIM_EXPORT size_t malloc_usable_size(void* ptr) {
+    Arena* arena = ptr ? arenaOf(ptr) : nullptr;
+    return arena ? arena->allocator().usable_size(ptr) : 0;
+}
+
+} // extern "C"
+
+// --- C++ Allocation Functions ---
+
+SHIM_EXPORT void* operator new(size_t size) {
+    return newWith([size] { return shimAllocate(size); });
+}
+
+SHIM_EXPORT void* operator new[](size_t size) {
+    return newWith([size] { return shimAllocate(size); });
+}
+
+SHIM_EXPORT void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return shimAllocate(size);
+}
+
+SHIM_EXPORT void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return shimAllocate(size);
+}
+
+SHIM_EXPORT void* operator new(size_t size, std::align_val_t alignment) {
+    return newWith([size, alignment] { return shimAlignedAllocate((size_t)alignment, size); });
+}
+
+SHIM_EXPORT void* operator new[](size_t size, std::align_val_t alignment) {
+    return newWith([size, alignment] { return shimAlignedAllocate((size_t)alignment, size); });
+}
+
+SHIM_EXPORT void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return shimAlignedAllocate((size_t)alignment, size);
+}
+
+SHIM_EXPORT void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return shimAlignedAllocate((size_t)alignment, size);
+}
+
+SHIM_EXPORT void operator delete(void* ptr) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete[](void* ptr) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete(void* ptr, size_t size) noexcept {
+    shimDeallocateSized(ptr, size);
+}
+
+SHIM_EXPORT void operator delete[](void* ptr, size_t size) noexcept {
+    shimDeallocateSized(ptr, size);
+}
+
+SHIM_EXPORT void operator delete(void* ptr, std::align_val_t) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete[](void* ptr, std::align_val_t) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    shimDeallocate(ptr);
+}
+
+SHIM_EXPORT void operator delete(void* ptr, size_t size, std::align_val_t) noexcept {
+    shimDeallocateSized(ptr, size);
+}
+
+SHIM_EXPORT void operator delete[](void* ptr, size_t size, std::align_val_t) noexcept {
+    shimDeallocateSized(ptr, size);
+}
@@ -0,0 +1,120 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include "allocator.h"
+
+#include <algorithm> // for std::max
+#include <cstddef>   // for size_t
+#include <new>       // for placement new
+#include <utility>   // for std::forward
+
+// =================================================================================
+// ObjectPool Class
+//
+// A pool of fixed-size slots for objects of type T, carved out of an Allocator
+// in slabs of slots_per_slab slots each. A free slot holds the link of an
+// intrusive free list in its own storage, so objects carry no header at all and
+// sit next to each other in memory. Allocating pops the free list and freeing
+// pushes onto it; only when the list is empty does the pool hand out the next
+// untouched slot of the newest slab, and only when that slab is used up does it
+// go to the Allocator for another.
+//
+// Slabs are given back to the Allocator when the ObjectPool is destroyed, not
+// before. Objects still alive at that point are not destroyed. The pool has no
+// synchronization of its own; Pool may be ConcurrentAllocator or ThreadArenas,
+// but each ObjectPool must still be used by one thread at a time.
+// =================================================================================
+template <typename T, typename Pool = Allocator>
+class ObjectPool {
+public:
+    // Constructor: Slabs come from 'pool', which must outlive the ObjectPool.
+    explicit ObjectPool(Pool& pool, size_t slots_per_slab = 64)
+        : m_pool(pool), m_slots_per_slab(std::max<size_t>(slots_per_slab, 1)), m_slabs(nullptr),
+          m_free_slots(nullptr), m_next_unused(nullptr), m_slab_end(nullptr) {}
+
+    // Destructor: Returns every slab to the pool.
+    ~ObjectPool() {
+        while (m_slabs) {
+            Slab* next = m_slabs->next;
+            m_pool.deallocate(m_slabs);
+            m_slabs = next;
+        }
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // allocate: Uninitialized storage for one T, or nullptr if the pool is
+    // out of memory.
+    void* allocate() {
+        if (Slot* slot = m_free_slots) {
+            m_free_slots = slot->next;
+            return slot;
+        }
+        if (m_next_unused == m_slab_end && !addSlab()) {
+            return nullptr;
+        }
+        return m_next_unused++;
+    }
+
+    // deallocate: Give back storage obtained from allocate.
+    void deallocate(void* ptr) {
+        Slot* slot = (Slot*)ptr;
+        slot->next = m_free_slots;
+        m_free_slots = slot;
+    }
+
+    // create: Allocate a slot and construct a T in it from args.
+    template <typename... Args>
+    T* create(Args&&... args) {
+        void* storage = allocate();
+        return storage ? new (storage) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    // destroy: Destroy an object made by create and free its slot.
+    void destroy(T* object) {
+        if (object) {
+            object->~T();
+            deallocate(object);
+        }
+    }
+
+private:
+    // A slot holds either an object or, while free, the next free slot.
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    // Each slab starts with a link to the previously allocated slab, followed
+    // by its slots.
+    struct Slab {
+        Slab* next;
+    };
+    static constexpr size_t SLOTS_OFFSET = (sizeof(Slab) + alignof(Slot) - 1) / alignof(Slot) * alignof(Slot);
+
+    Pool& m_pool;
+    const size_t m_slots_per_slab;
+    Slab* m_slabs;        // Every slab, newest first.
+    Slot* m_free_slots;   // Slots that have been freed.
+    Slot* m_next_unused;  // The newest slab's slots from here on have never been used.
+    Slot* m_slab_end;
+
+    // addSlab: Get a new slab from the pool and make its slots the unused ones.
+    bool addSlab() {
+        const size_t slab_size = SLOTS_OFFSET + m_slots_per_slab * sizeof(Slot);
+        const size_t alignment = std::max(alignof(Slot), alignof(Slab));
+        Slab* slab = (Slab*)(alignment <= BLOCK_GRANULE ? m_pool.allocate(slab_size)
+                                                        : m_pool.aligned_allocate(slab_size, alignment));
+        if (!slab) {
+            return false;
+        }
+        slab->next = m_slabs;
+        m_slabs = slab;
+        m_next_unused = (Slot*)((char*)slab + SLOTS_OFFSET);
+        m_slab_end = m_next_unused + m_slots_per_slab;
+        return true;
+    }
+};
+
+#endif // OBJECT_POOL_H
@@ -0,0 +1,61 @@
+#include "os_memory.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+size_t os_page_size() {
+    static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    return page_size;
+}
+
+size_t os_round_to_pages(size_t size) {
+    const size_t page_size = os_page_size();
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+void* os_reserve(size_t size) {
+    void* addr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return addr == MAP_FAILED ? nullptr : addr;
+}
+
+bool os_commit(void* addr, size_t size) {
+    return mprotect(addr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+bool os_purge(void* addr, size_t size, bool lazy) {
+#ifdef MADV_FREE
+    if (lazy && madvise(addr, size, MADV_FREE) == 0) {
+        return true;
+    }
+#endif
+    // MADV_FREE needs Linux 4.5; fall back to dropping the pages outright.
+    (void)lazy;
+    return madvise(addr, size, MADV_DONTNEED) == 0;
+}
+
+void* os_map_shared(int fd, size_t size, void* addr) {
+    int flags = MAP_SHARED;
+#ifdef MAP_FIXED_NOREPLACE
+    if (addr) {
+        flags |= MAP_FIXED_NOREPLACE;
+    }
+#endif
+    void* mapped = mmap(addr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+    // Kernels before 4.17 take MAP_FIXED_NOREPLACE as a mere hint.
+    if (addr && mapped != addr) {
+        munmap(mapped, size);
+        return nullptr;
+    }
+    return mapped;
+}
+
+bool os_sync(void* addr, size_t size) {
+    return msync(addr, size, MS_SYNC) == 0;
+}
+
+void os_release(void* addr, size_t size) {
+    munmap(addr, size);
+}
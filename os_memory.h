@@ -0,0 +1,44 @@
+#ifndef OS_MEMORY_H
+#define OS_MEMORY_H
+
+#include <cstddef> // for size_t
+
+// =================================================================================
+// OS Memory Helpers
+//
+// Thin wrappers around the virtual-memory calls the allocators are built on.
+// Address space is reserved first (no access, no memory charged) and committed
+// in pieces as it is needed.
+// =================================================================================
+
+// os_page_size: The size of a virtual-memory page.
+size_t os_page_size();
+
+// os_round_to_pages: size rounded up to a whole number of pages.
+size_t os_round_to_pages(size_t size);
+
+// os_reserve: Reserve 'size' bytes of address space. Returns nullptr on failure.
+void* os_reserve(size_t size);
+
+// os_commit: Make [addr, addr + size) readable and writable. Both must be page aligned.
+bool os_commit(void* addr, size_t size);
+
+// os_purge: Tell the OS the contents of [addr, addr + size) are no longer
+// needed. The range stays mapped and reads back as zeroes once the pages have
+// been reclaimed. With 'lazy' the kernel only reclaims them under memory pressure.
+bool os_purge(void* addr, size_t size, bool lazy);
+
+// os_map_shared: Map 'size' bytes of the open file fd readable and writable,
+// shared with every other mapping of the file. With a non-null 'addr' the
+// mapping must land exactly there. Returns nullptr on failure.
+void* os_map_shared(int fd, size_t size, void* addr = nullptr);
+
+// os_sync: Write the changes to [addr, addr + size) of a shared file mapping
+// back to the file, returning once they are on disk. addr must be page aligned.
+bool os_sync(void* addr, size_t size);
+
+// os_release: Give a reservation made by os_reserve, or a mapping made by
+// os_map_shared, back to the OS.
+void os_release(void* addr, size_t size);
+
+#endif // OS_MEMORY_H
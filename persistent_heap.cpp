@@ -0,0 +1,190 @@
+#include "persistent_heap.h"
+#include "os_memory.h"
+
+#include <new> // for placement new
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Written last when a heap file is created, so a file that has it is complete.
+const uint64_t HEAP_MAGIC = 0x3130305041454850ull; // "PHEAP001"
+
+} // namespace
+
+// The start of a heap file. The pool follows on the next page.
+struct PersistentHeap::Header {
+    uint64_t magic;
+    size_t file_size;
+    size_t pool_offset;
+    size_t allocator_size;     // sizeof(Allocator), to catch programs built differently.
+    bool compact_links;        // Whether the file was created with ALLOCATOR_COMPACT_LINKS.
+    bool clean_shutdown;       // Cleared while the heap is open.
+    void* base_address;        // Where the file was mapped when it was created.
+    size_t roots[ROOT_COUNT];  // Offsets from the start of the file; 0 for none.
+    alignas(Allocator) unsigned char allocator[sizeof(Allocator)];
+};
+
+// --- PersistentHeap Method Implementations ---
+
+PersistentHeap::PersistentHeap(const char* path, size_t pool_size, FitPolicy policy)
+    : m_header(nullptr), m_file_size(0), m_restored(false), m_recovered(false) {
+    const int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        std::cerr << "Could not open the heap file." << std::endl;
+        return;
+    }
+    struct stat info;
+    const bool opened = fstat(fd, &info) == 0 &&
+                        (info.st_size == 0 ? create(fd, pool_size, policy) : restore(fd, (size_t)info.st_size));
+    close(fd);
+    if (!opened) {
+        return;
+    }
+
+    // From here until the destructor runs, the file says the heap is open, so
+    // if the process dies the next one to open it knows to recover.
+    m_header->clean_shutdown = false;
+    os_sync(m_header, os_page_size());
+}
+
+PersistentHeap::~PersistentHeap() {
+    if (m_header) {
+        // The heap goes to disk before the flag that says it is complete.
+        os_sync(m_header, m_file_size);
+        m_header->clean_shutdown = true;
+        os_sync(m_header, os_page_size());
+        os_release(m_header, m_file_size);
+    }
+}
+
+bool PersistentHeap::create(int fd, size_t pool_size, FitPolicy policy) {
+    const size_t pool_offset = os_round_to_pages(sizeof(Header));
+    const size_t file_size = pool_offset + os_round_to_pages(pool_size);
+    void* mapping = ftruncate(fd, (off_t)file_size) == 0 ? os_map_shared(fd, file_size) : nullptr;
+    if (!mapping) {
+        std::cerr << "Could not map the heap file." << std::endl;
+        return false;
+    }
+
+    // A new file reads as zeroes, so every root starts out empty.
+    Header* header = (Header*)mapping;
+    header->file_size = file_size;
+    header->pool_offset = pool_offset;
+    header->allocator_size = sizeof(Allocator);
+    header->compact_links = COMPACT_LINKS;
+    header->base_address = mapping;
+    new (header->allocator) Allocator((char*)mapping + pool_offset, file_size - pool_offset, policy);
+    os_sync(mapping, file_size);
+    header->magic = HEAP_MAGIC;
+
+    m_header = header;
+    m_file_size = file_size;
+    return true;
+}
+
+bool PersistentHeap::restore(int fd, size_t file_size) {
+    void* mapping = file_size >= sizeof(Header) ? os_map_shared(fd, file_size) : nullptr;
+    Header* header = (Header*)mapping;
+    if (!header || header->magic != HEAP_MAGIC || header->file_size != file_size ||
+        header->allocator_size != sizeof(Allocator) || header->compact_links != COMPACT_LINKS) {
+        std::cerr << "The file is not a heap this program can use." << std::endl;
+        if (mapping) {
+            os_release(mapping, file_size);
+        }
+        return false;
+    }
+
+    // Without compact links the pool is full of pointers from the run that
+    // created it, so it has to be mapped at the same address again.
+    if (!COMPACT_LINKS && mapping != header->base_address) {
+        void* const base_address = header->base_address;
+        os_release(mapping, file_size);
+        mapping = os_map_shared(fd, file_size, base_address);
+        if (!mapping) {
+            std::cerr << "Could not map the heap file at the address it was created at." << std::endl;
+            return false;
+        }
+        header = (Header*)mapping;
+    }
+
+    Allocator& pool = *(Allocator*)header->allocator;
+    pool.rebase((char*)mapping + header->pool_offset);
+    if (!header->clean_shutdown) {
+        m_recovered = true;
+        if (!pool.recover()) {
+            os_release(mapping, file_size);
+            return false;
+        }
+    }
+
+    m_header = header;
+    m_file_size = file_size;
+    m_restored = true;
+    return true;
+}
+
+Allocator& PersistentHeap::allocator() const {
+    return *(Allocator*)m_header->allocator;
+}
+
+void* PersistentHeap::allocate(size_t size) {
+    return m_header ? allocator().allocate(size) : nullptr;
+}
+
+void* PersistentHeap::aligned_allocate(size_t size, size_t alignment) {
+    return m_header ? allocator().aligned_allocate(size, alignment) : nullptr;
+}
+
+void PersistentHeap::deallocate(void* ptr) {
+    if (m_header) {
+        allocator().deallocate(ptr);
+    }
+}
+
+void PersistentHeap::deallocate(void* ptr, size_t size) {
+    if (m_header) {
+        allocator().deallocate(ptr, size);
+    }
+}
+
+void* PersistentHeap::reallocate(void* ptr, size_t new_size) {
+    return m_header ? allocator().reallocate(ptr, new_size) : nullptr;
+}
+
+size_t PersistentHeap::usable_size(const void* ptr) const {
+    return allocator().usable_size(ptr);
+}
+
+void PersistentHeap::set_root(size_t index, void* ptr) {
+    if (!m_header || index >= ROOT_COUNT) {
+        std::cerr << "Invalid root slot." << std::endl;
+        return;
+    }
+    m_header->roots[index] = ptr ? offset_of(ptr) : 0;
+}
+
+void* PersistentHeap::root(size_t index) const {
+    if (!m_header || index >= ROOT_COUNT || m_header->roots[index] == 0) {
+        return nullptr;
+    }
+    return pointer_at(m_header->roots[index]);
+}
+
+bool PersistentHeap::sync() {
+    return m_header && os_sync(m_header, m_file_size);
+}
+
+void PersistentHeap::print_free_list() const {
+    if (!m_header) {
+        std::cout << "[NOT OPEN]" << std::endl;
+        return;
+    }
+    allocator().print_free_list();
+}
+
+AllocatorStats PersistentHeap::stats() const {
+    return m_header ? allocator().stats() : AllocatorStats();
+}
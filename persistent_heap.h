@@ -0,0 +1,103 @@
+#ifndef PERSISTENT_HEAP_H
+#define PERSISTENT_HEAP_H
+
+#include "allocator.h"
+
+#include <cstddef> // for size_t
+
+// =================================================================================
+// PersistentHeap Class
+//
+// An Allocator whose pool is a memory-mapped file, so that the heap outlives
+// the process: a restarted process opens the same file and finds every block
+// it had allocated where it left it, instead of rebuilding its data.
+//
+// The file starts with a header holding a table of ROOT_COUNT root slots, the
+// entry points from which the program finds its data again, and the Allocator
+// itself, placed over the rest of the file. The header also records whether the
+// heap was closed cleanly. If it was not, because the process died with the
+// heap open, opening it again rebuilds the free lists from the block headers
+// (see Allocator::recover).
+//
+// Roots are stored as offsets and turned back into pointers on open. In the
+// compact build (ALLOCATOR_COMPACT_LINKS) the file may be mapped anywhere, so
+// data in the heap that refers to other data in the heap must do so by offset
+// (offset_of / pointer_at). Otherwise the pool holds absolute pointers and the
+// file is always mapped at the address it was created at; opening fails if
+// that address is taken. Changes reach the disk when the heap is closed or
+// sync() is called; a machine crash may lose what was written since.
+//
+// Like Allocator, a PersistentHeap has no synchronization, and a file must only
+// be open in one PersistentHeap at a time.
+// =================================================================================
+class PersistentHeap {
+public:
+    static constexpr size_t ROOT_COUNT = 16;
+
+    // Constructor: Opens the heap in the file at 'path', or creates the file
+    // with room for pool_size bytes of blocks if it does not exist. For an
+    // existing heap pool_size and policy are ignored.
+    PersistentHeap(const char* path, size_t pool_size, FitPolicy policy = FitPolicy::FirstFit);
+
+    // Destructor: Writes the heap back to the file, marks it closed cleanly
+    // and unmaps it.
+    ~PersistentHeap();
+
+    PersistentHeap(const PersistentHeap&) = delete;
+    PersistentHeap& operator=(const PersistentHeap&) = delete;
+
+    // is_open: False if the file could not be created or opened as a heap.
+    bool is_open() const { return m_header != nullptr; }
+
+    // was_restored / was_recovered: Whether an existing heap was opened, and
+    // whether its free lists had to be rebuilt because it was not closed cleanly.
+    bool was_restored() const { return m_restored; }
+    bool was_recovered() const { return m_recovered; }
+
+    // allocate / aligned_allocate / deallocate / reallocate / usable_size: As
+    // on Allocator. The pool does not grow.
+    void* allocate(size_t size);
+    void* aligned_allocate(size_t size, size_t alignment);
+    void deallocate(void* ptr);
+    void deallocate(void* ptr, size_t size);
+    void* reallocate(void* ptr, size_t new_size);
+    size_t usable_size(const void* ptr) const;
+
+    // owns: True if ptr points into the heap.
+    bool owns(const void* ptr) const { return m_header && allocator().owns(ptr); }
+
+    // set_root / root: Store a block (or nullptr) in root slot 'index', and
+    // read it back, typically after the heap has been reopened.
+    void set_root(size_t index, void* ptr);
+    void* root(size_t index) const;
+
+    // offset_of / pointer_at: Convert between a pointer into the heap and its
+    // offset from the start of the file, which does not change between runs.
+    size_t offset_of(const void* ptr) const { return (const char*)ptr - (const char*)m_header; }
+    void* pointer_at(size_t offset) const { return (char*)m_header + offset; }
+
+    // sync: Write the heap back to the file now. It stays marked as open.
+    bool sync();
+
+    // print_free_list: Print the heap's free list.
+    void print_free_list() const;
+
+    // stats: The heap's usage counters, carried over from earlier runs.
+    AllocatorStats stats() const;
+
+private:
+    struct Header;
+
+    Header* m_header;  // The start of the mapping; nullptr if not open.
+    size_t m_file_size;
+    bool m_restored;
+    bool m_recovered;
+
+    Allocator& allocator() const;
+
+    // create / restore: Set up a new heap file, or map an existing one.
+    bool create(int fd, size_t pool_size, FitPolicy policy);
+    bool restore(int fd, size_t file_size);
+};
+
+#endif // PERSISTENT_HEAP_H
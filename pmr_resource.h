@@ -0,0 +1,62 @@
+#ifndef PMR_RESOURCE_H
+#define PMR_RESOURCE_H
+
+#include "allocator.h"
+
+#include <cstddef>         // for size_t
+#include <memory_resource>
+#include <new>             // for std::bad_alloc
+
+// =================================================================================
+// AllocatorResource Class
+//
+// A std::pmr::memory_resource that serves memory from an Allocator, so pmr
+// containers can use the pool without any change at their call sites:
+//
+//     Allocator pool(1024 * 1024);
+//     AllocatorResource<> resource(pool);
+//     std::pmr::vector<int> numbers(&resource);
+//
+// ConcurrentAllocator and ThreadArenas have the same interface and can be used
+// as the Pool instead, for containers shared between threads. The resource
+// does not own the pool, which must outlive it. memory_resource requires that a
+// failed allocation throws, so unlike the pool itself this throws std::bad_alloc
+// when the pool runs out.
+// =================================================================================
+template <typename Pool = Allocator>
+class AllocatorResource : public std::pmr::memory_resource {
+public:
+    explicit AllocatorResource(Pool& pool) : m_pool(pool) {}
+
+    // pool: The pool this resource allocates from.
+    Pool& pool() const { return m_pool; }
+
+private:
+    Pool& m_pool;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        // Even a zero-byte request must return a distinct pointer. Requests the
+        // pool aligns anyway take the plain path, which ConcurrentAllocator can
+        // serve from its thread caches.
+        if (bytes == 0) {
+            bytes = 1;
+        }
+        void* ptr = alignment <= BLOCK_GRANULE ? m_pool.allocate(bytes) : m_pool.aligned_allocate(bytes, alignment);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t) override {
+        m_pool.deallocate(ptr, bytes == 0 ? 1 : bytes);
+    }
+
+    // Memory from a pool may be freed through any resource over the same pool.
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        const AllocatorResource* that = dynamic_cast<const AllocatorResource*>(&other);
+        return that && &that->m_pool == &m_pool;
+    }
+};
+
+#endif // PMR_RESOURCE_H
@@ -0,0 +1,221 @@
+#include "shared_allocator.h"
+#include "os_memory.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring> // for std::strerror
+#include <new>     // for placement new
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Written last when a segment is created, so a segment that has it is ready.
+const uint64_t SEGMENT_MAGIC = 0x314C4F4F504D4853ull; // "SHMPOOL1"
+
+} // namespace
+
+// The start of a segment. The pool follows on the next page.
+struct SharedAllocator::Segment {
+    std::atomic<uint64_t> magic;
+    size_t mapping_size;
+    size_t pool_offset;
+    size_t allocator_size;  // sizeof(Allocator), to catch processes built differently.
+    bool compact_links;     // Whether the creator was built with ALLOCATOR_COMPACT_LINKS.
+    void* creator_address;  // Where the creating process mapped the segment.
+    pthread_mutex_t lock;
+    alignas(Allocator) unsigned char allocator[sizeof(Allocator)];
+};
+
+// --- SharedAllocator Method Implementations ---
+
+SharedAllocator::SharedAllocator(const char* name, size_t pool_size, FitPolicy policy)
+    : m_segment(nullptr), m_mapping_size(0), m_pool(nullptr) {
+    const size_t pool_offset = os_round_to_pages(sizeof(Segment));
+    const size_t mapping_size = pool_offset + os_round_to_pages(pool_size);
+
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        std::cerr << "Could not create the shared memory segment." << std::endl;
+        return;
+    }
+    // The segment reads as zeroes and takes no memory until it is touched.
+    void* mapping = ftruncate(fd, (off_t)mapping_size) == 0 ? os_map_shared(fd, mapping_size) : nullptr;
+    close(fd);
+    if (!mapping) {
+        std::cerr << "Could not map the shared memory segment." << std::endl;
+        shm_unlink(name);
+        return;
+    }
+
+    Segment* segment = (Segment*)mapping;
+    segment->mapping_size = mapping_size;
+    segment->pool_offset = pool_offset;
+    segment->allocator_size = sizeof(Allocator);
+    segment->compact_links = COMPACT_LINKS;
+    segment->creator_address = mapping;
+
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&segment->lock, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+
+    new (segment->allocator) Allocator((char*)mapping + pool_offset, mapping_size - pool_offset, policy);
+    segment->magic.store(SEGMENT_MAGIC, std::memory_order_release);
+
+    m_segment = segment;
+    m_mapping_size = mapping_size;
+    m_pool = (char*)mapping + pool_offset;
+}
+
+SharedAllocator::SharedAllocator(const char* name) : m_segment(nullptr), m_mapping_size(0), m_pool(nullptr) {
+    const int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "Could not open the shared memory segment." << std::endl;
+        return;
+    }
+    struct stat info;
+    const size_t mapping_size = fstat(fd, &info) == 0 ? (size_t)info.st_size : 0;
+    void* mapping = mapping_size >= sizeof(Segment) ? os_map_shared(fd, mapping_size) : nullptr;
+
+    Segment* segment = (Segment*)mapping;
+    if (!segment || segment->magic.load(std::memory_order_acquire) != SEGMENT_MAGIC ||
+        segment->mapping_size != mapping_size || segment->allocator_size != sizeof(Allocator) ||
+        segment->compact_links != COMPACT_LINKS) {
+        std::cerr << "The shared memory segment is not a pool this program can use." << std::endl;
+        if (mapping) {
+            os_release(mapping, mapping_size);
+        }
+        close(fd);
+        return;
+    }
+
+    // Without compact links the pool is full of the creator's pointers, so it
+    // has to be mapped where the creator mapped it.
+    if (!COMPACT_LINKS && mapping != segment->creator_address) {
+        void* const creator_address = segment->creator_address;
+        os_release(mapping, mapping_size);
+        mapping = os_map_shared(fd, mapping_size, creator_address);
+        if (!mapping) {
+            std::cerr << "Could not map the shared pool at the address it was created at." << std::endl;
+            close(fd);
+            return;
+        }
+        segment = (Segment*)mapping;
+    }
+    close(fd);
+
+    m_segment = segment;
+    m_mapping_size = mapping_size;
+    m_pool = (char*)mapping + segment->pool_offset;
+}
+
+SharedAllocator::~SharedAllocator() {
+    if (m_segment) {
+        os_release(m_segment, m_mapping_size);
+    }
+}
+
+bool SharedAllocator::remove(const char* name) {
+    return shm_unlink(name) == 0;
+}
+
+template <typename Fn>
+auto SharedAllocator::withPool(Fn&& fn) const -> decltype(fn(std::declval<Allocator&>())) {
+    using Result = decltype(fn(std::declval<Allocator&>()));
+
+    // Without the lock the pool must not be touched at all; the call fails as
+    // it would if the pool were full (or does nothing, for a free).
+    const int error = pthread_mutex_lock(&m_segment->lock);
+    if (error != 0 && error != EOWNERDEAD) {
+        std::cerr << "Could not lock the shared pool: " << std::strerror(error) << std::endl;
+        return Result();
+    }
+
+    struct Unlock {
+        pthread_mutex_t* lock;
+        ~Unlock() { pthread_mutex_unlock(lock); }
+    } unlock{&m_segment->lock};
+
+    Allocator& allocator = *(Allocator*)m_segment->allocator;
+    allocator.rebase(m_pool);
+    if (error == EOWNERDEAD) {
+        // The holder died part way through a call, so the free lists may be
+        // half updated. The block it was working on is lost to the pool.
+        std::cerr << "A process died while holding the shared pool's lock; recovering." << std::endl;
+        if (!allocator.recover()) {
+            // Unlocking without marking the lock consistent leaves it
+            // permanently unusable, so every later call fails above instead of
+            // using a broken pool.
+            std::cerr << "The shared pool could not be recovered." << std::endl;
+            return Result();
+        }
+        pthread_mutex_consistent(&m_segment->lock);
+    }
+    return fn(allocator);
+}
+
+void* SharedAllocator::allocate(size_t size) {
+    if (!m_segment) {
+        return nullptr;
+    }
+    return withPool([size](Allocator& allocator) { return allocator.allocate(size); });
+}
+
+void* SharedAllocator::aligned_allocate(size_t size, size_t alignment) {
+    if (!m_segment) {
+        return nullptr;
+    }
+    return withPool([size, alignment](Allocator& allocator) { return allocator.aligned_allocate(size, alignment); });
+}
+
+void SharedAllocator::deallocate(void* ptr) {
+    if (!m_segment || ptr == nullptr) {
+        return;
+    }
+    withPool([ptr](Allocator& allocator) { allocator.deallocate(ptr); });
+}
+
+void SharedAllocator::deallocate(void* ptr, size_t size) {
+    if (!m_segment || ptr == nullptr) {
+        return;
+    }
+    withPool([ptr, size](Allocator& allocator) { allocator.deallocate(ptr, size); });
+}
+
+void* SharedAllocator::reallocate(void* ptr, size_t new_size) {
+    if (!m_segment) {
+        return nullptr;
+    }
+    return withPool([ptr, new_size](Allocator& allocator) { return allocator.reallocate(ptr, new_size); });
+}
+
+size_t SharedAllocator::usable_size(const void* ptr) const {
+    if (!m_segment) {
+        return 0;
+    }
+    // Only the block's own header is read, so this needs neither the lock nor
+    // the pool's address.
+    return ((const Allocator*)m_segment->allocator)->usable_size(ptr);
+}
+
+void SharedAllocator::print_free_list() const {
+    if (!m_segment) {
+        std::cout << "[NOT ATTACHED]" << std::endl;
+        return;
+    }
+    withPool([](Allocator& allocator) { allocator.print_free_list(); });
+}
+
+AllocatorStats SharedAllocator::stats() const {
+    if (!m_segment) {
+        return AllocatorStats();
+    }
+    return withPool([](Allocator& allocator) { return allocator.stats(); });
+}
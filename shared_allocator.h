@@ -0,0 +1,99 @@
+#ifndef SHARED_ALLOCATOR_H
+#define SHARED_ALLOCATOR_H
+
+#include "allocator.h"
+
+#include <cstddef> // for size_t
+#include <utility> // for std::declval
+
+// =================================================================================
+// SharedAllocator Class
+//
+// An Allocator whose pool lives in a POSIX shared-memory segment, so that
+// several processes allocate from one pool and a block allocated in one process
+// can be handed to another without copying, and freed there. One process
+// creates the segment; the others attach to it by name.
+//
+// Everything lives in the segment: a small header holding a process-shared
+// mutex, the Allocator itself (placed over the rest of the segment), and the
+// pool. Every call takes the mutex. The mutex is robust, so a process that dies
+// while holding it does not block the others: the next process to take it
+// rebuilds the free lists (see Allocator::recover). If the mutex cannot be
+// taken, or the pool cannot be rebuilt, the call is reported and fails without
+// touching the pool.
+//
+// Processes may map the segment at different addresses, so pointers into it
+// must be passed between them as offsets (offset_of / pointer_at). In the
+// compact build (ALLOCATOR_COMPACT_LINKS) the pool holds only offsets, and each
+// call first points the Allocator at the calling process's mapping. Otherwise
+// the pool holds absolute pointers, and attaching fails unless the segment can
+// be mapped at the same address as in the process that created it.
+// =================================================================================
+class SharedAllocator {
+public:
+    // Constructor (create): Creates the segment 'name' (a POSIX shared-memory
+    // name such as "/my_pool") with room for pool_size bytes of blocks. Fails if
+    // a segment of that name already exists.
+    SharedAllocator(const char* name, size_t pool_size, FitPolicy policy = FitPolicy::FirstFit);
+
+    // Constructor (attach): Maps the existing segment 'name', once the process
+    // creating it has finished constructing its SharedAllocator.
+    explicit SharedAllocator(const char* name);
+
+    // Destructor: Unmaps the segment. The segment and the blocks in it remain
+    // until remove() is called and every process has unmapped it.
+    ~SharedAllocator();
+
+    SharedAllocator(const SharedAllocator&) = delete;
+    SharedAllocator& operator=(const SharedAllocator&) = delete;
+
+    // remove: Delete the segment 'name'. Processes that have it mapped keep
+    // using it; no new process can attach.
+    static bool remove(const char* name);
+
+    // is_attached: False if creating or attaching to the segment failed.
+    bool is_attached() const { return m_segment != nullptr; }
+
+    // allocate / aligned_allocate / deallocate / reallocate: As on Allocator,
+    // but safe to call from any thread of any process that has the segment
+    // mapped. A block may be freed by a different process than allocated it.
+    void* allocate(size_t size);
+    void* aligned_allocate(size_t size, size_t alignment);
+    void deallocate(void* ptr);
+    void deallocate(void* ptr, size_t size);
+    void* reallocate(void* ptr, size_t new_size);
+
+    // usable_size: As on Allocator; 0 if not attached.
+    size_t usable_size(const void* ptr) const;
+
+    // owns: True if ptr points into this process's mapping of the pool.
+    bool owns(const void* ptr) const {
+        return m_segment && (const char*)ptr >= m_pool && (const char*)ptr < (const char*)m_segment + m_mapping_size;
+    }
+
+    // offset_of / pointer_at: Convert between a pointer into the segment and
+    // its offset from the start of the segment, which is the same in every
+    // process.
+    size_t offset_of(const void* ptr) const { return (const char*)ptr - (const char*)m_segment; }
+    void* pointer_at(size_t offset) const { return (char*)m_segment + offset; }
+
+    // print_free_list: Print the pool's free list.
+    void print_free_list() const;
+
+    // stats: The pool's usage counters, across all processes.
+    AllocatorStats stats() const;
+
+private:
+    struct Segment;
+
+    Segment* m_segment;     // This process's mapping; nullptr if not attached.
+    size_t m_mapping_size;
+    char* m_pool;           // Where the pool starts in this process's mapping.
+
+    // withPool: Run fn on the Allocator under the segment's lock, with the
+    // Allocator pointed at this process's mapping.
+    template <typename Fn>
+    auto withPool(Fn&& fn) const -> decltype(fn(std::declval<Allocator&>()));
+};
+
+#endif // SHARED_ALLOCATOR_H
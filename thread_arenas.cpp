@@ -0,0 +1,214 @@
+#include "thread_arenas.h"
+
+#include <algorithm> // for std::max
+#include <cstring>   // for std::memcpy
+#include <iostream>
+#include <utility> // for std::pair
+
+namespace {
+
+std::atomic<uint64_t> g_next_arenas_id{1};
+
+// The arena each ThreadArenas instance has bound this thread to, keyed by the
+// instance's id. A thread rarely uses more than one instance.
+thread_local std::vector<std::pair<uint64_t, size_t>> t_arena_bindings;
+
+} // namespace
+
+// --- ThreadArenas Method Implementations ---
+
+ThreadArenas::ThreadArenas(size_t num_arenas, size_t arena_size, FitPolicy policy, size_t max_arena_size)
+    : m_next_arena(0), m_id(g_next_arenas_id.fetch_add(1)) {
+    if (num_arenas == 0) {
+        num_arenas = 1;
+    }
+    for (size_t i = 0; i < num_arenas; ++i) {
+        m_arenas.push_back(std::make_unique<Arena>(arena_size, policy, max_arena_size));
+    }
+}
+
+size_t ThreadArenas::threadArena() {
+    for (const std::pair<uint64_t, size_t>& binding : t_arena_bindings) {
+        if (binding.first == m_id) {
+            return binding.second;
+        }
+    }
+
+    // First allocation from this thread: bind it to the next arena in turn.
+    const size_t index = m_next_arena.fetch_add(1, std::memory_order_relaxed) % m_arenas.size();
+    t_arena_bindings.emplace_back(m_id, index);
+    return index;
+}
+
+size_t ThreadArenas::arenaOf(const void* ptr) const {
+    // There are only a handful of arenas, so a linear scan of their ranges is
+    // cheaper than anything cleverer. owns() only reads an arena's reservation,
+    // never its current size, so no arena lock is needed.
+    for (size_t i = 0; i < m_arenas.size(); ++i) {
+        if (m_arenas[i]->allocator.owns(ptr)) {
+            return i;
+        }
+    }
+    return m_arenas.size();
+}
+
+void ThreadArenas::drainRemoteFrees(Arena& arena) {
+    // Take the whole stack at once. Only the lock holder ever pops, so the
+    // exchange can't suffer from ABA.
+    RemoteFree* block = arena.remote_frees.exchange(nullptr, std::memory_order_acquire);
+    while (block) {
+        RemoteFree* next = block->next;
+        arena.allocator.deallocate(block);
+        block = next;
+    }
+}
+
+template <typename AllocateFn>
+void* ThreadArenas::allocateIn(Arena& arena, AllocateFn&& allocate_fn) {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    if (arena.remote_frees.load(std::memory_order_relaxed)) {
+        drainRemoteFrees(arena);
+    }
+    return allocate_fn(arena.allocator);
+}
+
+template <typename AllocateFn>
+void* ThreadArenas::allocateAnywhere(AllocateFn&& allocate_fn) {
+    const size_t home = threadArena();
+    if (void* ptr = allocateIn(*m_arenas[home], allocate_fn)) {
+        return ptr;
+    }
+
+    // The thread's own arena is exhausted; borrow from the others.
+    for (size_t i = 1; i < m_arenas.size(); ++i) {
+        if (void* ptr = allocateIn(*m_arenas[(home + i) % m_arenas.size()], allocate_fn)) {
+            return ptr;
+        }
+    }
+    std::cerr << "Out of memory!" << std::endl;
+    return nullptr;
+}
+
+void* ThreadArenas::allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+    return allocateAnywhere([size](Allocator& allocator) { return allocator.try_allocate(size); });
+}
+
+void* ThreadArenas::aligned_allocate(size_t size, size_t alignment) {
+    if (size == 0) {
+        return nullptr;
+    }
+    return allocateAnywhere(
+        [size, alignment](Allocator& allocator) { return allocator.try_aligned_allocate(size, alignment); });
+}
+
+template <typename DeallocateFn>
+void ThreadArenas::deallocateWith(void* ptr, DeallocateFn&& deallocate_fn) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    const size_t origin = arenaOf(ptr);
+    if (origin == m_arenas.size()) {
+        std::cerr << "Pointer was not allocated by these arenas." << std::endl;
+        return;
+    }
+
+    Arena& arena = *m_arenas[origin];
+    if (origin == threadArena()) {
+        std::lock_guard<std::mutex> guard(arena.lock);
+        deallocate_fn(arena.allocator);
+        return;
+    }
+
+    // --- Remote Free ---
+    // Push the block onto its arena's stack; the arena frees it later.
+    RemoteFree* block = (RemoteFree*)ptr;
+    RemoteFree* head = arena.remote_frees.load(std::memory_order_relaxed);
+    do {
+        block->next = head;
+    } while (!arena.remote_frees.compare_exchange_weak(head, block, std::memory_order_release,
+                                                       std::memory_order_relaxed));
+}
+
+void ThreadArenas::deallocate(void* ptr) {
+    deallocateWith(ptr, [ptr](Allocator& allocator) { allocator.deallocate(ptr); });
+}
+
+void ThreadArenas::deallocate(void* ptr, size_t size) {
+    deallocateWith(ptr, [ptr, size](Allocator& allocator) { allocator.deallocate(ptr, size); });
+}
+
+void* ThreadArenas::reallocate(void* ptr, size_t new_size) {
+    if (ptr == nullptr) {
+        return allocate(new_size);
+    }
+    if (new_size == 0) {
+        deallocate(ptr);
+        return nullptr;
+    }
+
+    const size_t origin = arenaOf(ptr);
+    if (origin == m_arenas.size()) {
+        std::cerr << "Pointer was not allocated by these arenas." << std::endl;
+        return nullptr;
+    }
+
+    size_t old_size;
+    {
+        Arena& arena = *m_arenas[origin];
+        std::lock_guard<std::mutex> guard(arena.lock);
+        if (void* new_ptr = arena.allocator.try_reallocate(ptr, new_size)) {
+            return new_ptr;
+        }
+        old_size = arena.allocator.usable_size(ptr);
+    }
+
+    // The origin arena is out of room; move the block to another one. Only if
+    // none has room is the failure reported.
+    void* new_ptr = allocate(new_size);
+    if (new_ptr) {
+        std::memcpy(new_ptr, ptr, old_size);
+        deallocate(ptr);
+    }
+    return new_ptr;
+}
+
+void ThreadArenas::drain_remote_frees() {
+    for (std::unique_ptr<Arena>& arena : m_arenas) {
+        std::lock_guard<std::mutex> guard(arena->lock);
+        drainRemoteFrees(*arena);
+    }
+}
+
+AllocatorStats ThreadArenas::stats() const {
+    AllocatorStats total = {};
+    for (const std::unique_ptr<Arena>& arena : m_arenas) {
+        AllocatorStats stats;
+        {
+            std::lock_guard<std::mutex> guard(arena->lock);
+            stats = arena->allocator.stats();
+        }
+        total.pool_bytes += stats.pool_bytes;
+        total.allocated_bytes += stats.allocated_bytes;
+        total.free_bytes += stats.free_bytes;
+        total.peak_allocated_bytes += stats.peak_allocated_bytes;
+        total.allocation_count += stats.allocation_count;
+        total.free_count += stats.free_count;
+        total.free_block_count += stats.free_block_count;
+        total.largest_free_block = std::max(total.largest_free_block, stats.largest_free_block);
+    }
+    total.external_fragmentation =
+        total.free_bytes ? 1.0 - (double)total.largest_free_block / (double)total.free_bytes : 0.0;
+    return total;
+}
+
+void ThreadArenas::print_free_lists() const {
+    for (size_t i = 0; i < m_arenas.size(); ++i) {
+        std::lock_guard<std::mutex> guard(m_arenas[i]->lock);
+        std::cout << "Arena " << i << ":" << std::endl;
+        m_arenas[i]->allocator.print_free_list();
+    }
+}
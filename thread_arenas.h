@@ -0,0 +1,116 @@
+#ifndef THREAD_ARENAS_H
+#define THREAD_ARENAS_H
+
+#include "allocator.h"
+
+#include <atomic>
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <memory>  // for std::unique_ptr
+#include <mutex>
+#include <vector>
+
+// =================================================================================
+// ThreadArenas Class
+//
+// A set of independent arenas, each owning its own Allocator pool. Threads are
+// bound to arenas round-robin the first time they allocate, so with at least as
+// many arenas as threads no two threads share a pool.
+//
+// A block is always returned to the arena it came from, found by address. A
+// thread freeing a block from its own arena does so directly. A block that
+// belongs to another arena (the producer/consumer case) is pushed onto that
+// arena's remote-free stack without taking any lock; the arena drains the stack
+// into its pool the next time one of its threads allocates.
+// =================================================================================
+class ThreadArenas {
+public:
+    // Constructor: Creates num_arenas arenas with arena_size-byte pools, each of
+    // which may grow to max_arena_size bytes (see Allocator).
+    ThreadArenas(size_t num_arenas, size_t arena_size, FitPolicy policy = FitPolicy::FirstFit,
+                 size_t max_arena_size = 0);
+
+    ThreadArenas(const ThreadArenas&) = delete;
+    ThreadArenas& operator=(const ThreadArenas&) = delete;
+
+    // allocate / aligned_allocate: Allocate from the calling thread's arena,
+    // falling back to the other arenas when it is exhausted.
+    void* allocate(size_t size);
+    void* aligned_allocate(size_t size, size_t alignment);
+
+    // deallocate: Return a block to the arena it came from, from any thread.
+    void deallocate(void* ptr);
+
+    // deallocate (sized): As above, passing the size on to the arena's
+    // Allocator when the block is freed directly (see Allocator).
+    void deallocate(void* ptr, size_t size);
+
+    // reallocate: Resize a block within the arena it came from, in place if
+    // possible (see Allocator). If that arena is exhausted the block moves to
+    // whichever arena has room.
+    void* reallocate(void* ptr, size_t new_size);
+
+    // drain_remote_frees: Fold every arena's pending remote frees into its pool
+    // now instead of on its next allocation.
+    void drain_remote_frees();
+
+    // arena_count: How many arenas there are.
+    size_t arena_count() const { return m_arenas.size(); }
+
+    // print_free_lists: Print each arena's free list.
+    void print_free_lists() const;
+
+    // stats: The usage counters of all arenas combined. Blocks waiting on a
+    // remote-free stack count as allocated. The peak is the sum of each
+    // arena's own peak, so it can overstate the combined peak.
+    AllocatorStats stats() const;
+
+private:
+    // A block waiting on a remote-free stack, linked through its payload.
+    struct RemoteFree {
+        RemoteFree* next;
+    };
+
+    struct Arena {
+        mutable std::mutex lock;  // Guards allocator; threads sharing the arena take it.
+        Allocator allocator;
+        std::atomic<RemoteFree*> remote_frees{nullptr};  // Lock-free stack of foreign frees.
+
+        Arena(size_t arena_size, FitPolicy policy, size_t max_arena_size)
+            : allocator(arena_size, policy, max_arena_size) {}
+    };
+
+    std::vector<std::unique_ptr<Arena>> m_arenas;
+    std::atomic<size_t> m_next_arena;  // The arena the next new thread is bound to.
+
+    // Never reused, so a thread's binding can't leak to a new instance that
+    // happens to live at the same address.
+    const uint64_t m_id;
+
+    // threadArena: The index of the arena the calling thread is bound to.
+    size_t threadArena();
+
+    // arenaOf: The index of the arena whose pool holds ptr.
+    size_t arenaOf(const void* ptr) const;
+
+    // drainRemoteFrees: Free every block on the arena's remote-free stack. The
+    // caller holds the arena's lock.
+    static void drainRemoteFrees(Arena& arena);
+
+    // allocateIn: Run an allocation in one arena under its lock.
+    template <typename AllocateFn>
+    void* allocateIn(Arena& arena, AllocateFn&& allocate_fn);
+
+    // allocateAnywhere: Try the thread's arena first, then every other one.
+    // allocate_fn must fail quietly; running out is reported once, here, when
+    // every arena has failed.
+    template <typename AllocateFn>
+    void* allocateAnywhere(AllocateFn&& allocate_fn);
+
+    // deallocateWith: Free ptr with deallocate_fn if it belongs to the thread's
+    // own arena, or queue it on its arena's remote-free stack otherwise.
+    template <typename DeallocateFn>
+    void deallocateWith(void* ptr, DeallocateFn&& deallocate_fn);
+};
+
+#endif // THREAD_ARENAS_H